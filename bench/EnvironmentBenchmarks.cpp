@@ -0,0 +1,94 @@
+// bench/EnvironmentBenchmarks.cpp
+#include <benchmark/benchmark.h>
+
+#include "Environment.h"
+#include "PerfCounterReport.h"
+
+#include <string>
+#include <vector>
+
+static std::vector<std::string> names(int count) {
+    std::vector<std::string> result;
+    for (int i = 0; i < count; ++i) {
+        result.push_back("var" + std::to_string(i));
+    }
+    return result;
+}
+
+static void BM_EnvironmentDefine(benchmark::State &state) {
+    auto vars = names(static_cast<int>(state.range(0)));
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        Environment env;
+        for (const auto &name : vars) {
+            env.define(name, VarType::INT, 1);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EnvironmentDefine)->Arg(16)->Arg(1024);
+
+static void BM_EnvironmentGet(benchmark::State &state) {
+    auto vars = names(64);
+    Environment env;
+    for (const auto &name : vars) {
+        env.define(name, VarType::INT, 1);
+    }
+    size_t i = 0;
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(env.get(vars[i++ & 63]));
+    }
+}
+BENCHMARK(BM_EnvironmentGet);
+
+static void BM_EnvironmentAssign(benchmark::State &state) {
+    auto vars = names(64);
+    Environment env;
+    for (const auto &name : vars) {
+        env.define(name, VarType::INT, 1);
+    }
+    size_t i = 0;
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        env.assign(vars[i & 63], VarType::INT, static_cast<int>(i));
+        ++i;
+    }
+}
+BENCHMARK(BM_EnvironmentAssign);
+
+// A global looked up from `depth` nested scopes, as in a deeply nested block.
+static void BM_EnvironmentGetThroughScopes(benchmark::State &state) {
+    Environment global;
+    global.define("seed", VarType::INT, 3);
+    std::vector<Environment *> chain{&global};
+    for (int d = 0; d < state.range(0); ++d) {
+        chain.push_back(chain.back()->pushScope());
+        chain.back()->define("local", VarType::INT, d);
+    }
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(chain.back()->get("seed"));
+    }
+    for (size_t i = chain.size() - 1; i > 0; --i) {
+        delete chain[i];
+    }
+}
+BENCHMARK(BM_EnvironmentGetThroughScopes)->Arg(1)->Arg(8)->Arg(64);
+
+// Forking a global scope of state.range(0) variables: O(1) until the fork
+// writes, when it copies the variable table once.
+static void BM_EnvironmentFork(benchmark::State &state) {
+    auto vars = names(static_cast<int>(state.range(0)));
+    Environment global;
+    for (const auto &name : vars) {
+        global.define(name, VarType::INT, 1);
+    }
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        Environment fork(global);
+        benchmark::DoNotOptimize(fork.get(vars[0]));
+    }
+}
+BENCHMARK(BM_EnvironmentFork)->Arg(16)->Arg(4096);
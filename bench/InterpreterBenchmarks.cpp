@@ -0,0 +1,173 @@
+// bench/InterpreterBenchmarks.cpp
+#include <benchmark/benchmark.h>
+
+#include "Interpreter.h"
+#include "PerfCounterReport.h"
+#include "Program.h"
+#include "Workloads.h"
+
+// Execution only: each workload is compiled once and then called through a
+// FunctionHandle, so parsing is not part of the measurement.
+
+static void BM_Fib(benchmark::State &state) {
+    Interpreter interpreter(Program::compile(workloads::kFib));
+    auto fib = interpreter.function<int(int)>("fib");
+    const int n = static_cast<int>(state.range(0));
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fib(n));
+    }
+}
+BENCHMARK(BM_Fib)->Arg(15)->Arg(20)->Unit(benchmark::kMillisecond);
+
+static void BM_Factorial(benchmark::State &state) {
+    Interpreter interpreter(Program::compile(workloads::kFactorial));
+    auto factorial = interpreter.function<double(int)>("factorial");
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(factorial(20));
+    }
+}
+BENCHMARK(BM_Factorial)->Unit(benchmark::kMicrosecond);
+
+static void BM_NestedLoops(benchmark::State &state) {
+    Interpreter interpreter(Program::compile(workloads::kNestedLoops));
+    auto grid = interpreter.function<int(int)>("grid");
+    const int n = static_cast<int>(state.range(0));
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(grid(n));
+    }
+    state.SetItemsProcessed(state.iterations() * n * n);
+}
+BENCHMARK(BM_NestedLoops)->Arg(30)->Arg(100)->Unit(benchmark::kMillisecond);
+
+static void BM_DeepScopes(benchmark::State &state) {
+    Interpreter interpreter(Program::compile(workloads::deepScopes(static_cast<int>(state.range(0)))));
+    auto deep = interpreter.function<int(int)>("deep");
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(deep(100));
+    }
+}
+BENCHMARK(BM_DeepScopes)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+
+static void BM_SmallCalls(benchmark::State &state) {
+    Interpreter interpreter(Program::compile(workloads::kSmallCalls));
+    auto calls = interpreter.function<int(int)>("calls");
+    const int n = static_cast<int>(state.range(0));
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calls(n));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_SmallCalls)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// End to end: parse, register and run a whole file with a fresh interpreter.
+static void BM_RunFile(benchmark::State &state) {
+    std::string source = std::string(workloads::kFib) + "int main() { return fib(15); }\n";
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        Interpreter interpreter;
+        benchmark::DoNotOptimize(interpreter.evaluate(source, true));
+    }
+}
+BENCHMARK(BM_RunFile)->Unit(benchmark::kMillisecond);
+
+// Cost of the execution budget checks: arg 0 runs unbudgeted, arg 1 with a
+// budget that is never exceeded.
+static void BM_BudgetOverhead(benchmark::State &state) {
+    Interpreter interpreter;
+    interpreter.evaluate(workloads::kSmallCalls, false);
+    ExecutionBudget budget;
+    budget.maxSteps = 1ull << 40;
+    budget.maxCallDepth = 1000;
+    budget.timeout = std::chrono::hours(1);
+    const bool budgeted = state.range(0) != 0;
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        if (budgeted) {
+            benchmark::DoNotOptimize(interpreter.evaluate("calls(10000);", false, budget));
+        } else {
+            benchmark::DoNotOptimize(interpreter.evaluate("calls(10000);", false));
+        }
+    }
+}
+BENCHMARK(BM_BudgetOverhead)->ArgName("budget")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Cost of profiling: arg 0 off, arg 1 on.
+static void BM_ProfilerOverhead(benchmark::State &state) {
+    Interpreter interpreter;
+    interpreter.evaluate(workloads::kSmallCalls, false);
+    interpreter.enableProfiling(state.range(0) != 0);
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.evaluate("calls(10000);", false));
+    }
+}
+BENCHMARK(BM_ProfilerOverhead)->ArgName("profile")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Loop-invariant code motion: arg 0 with the optimizer off, arg 1 on.
+static void BM_LoopInvariants(benchmark::State &state) {
+    Interpreter interpreter;
+    OptimizerOptions options;
+    options.hoistLoopInvariants = state.range(0) != 0;
+    interpreter.setOptimizerOptions(options);
+    interpreter.evaluate(workloads::kLoopInvariants, false);
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.evaluate("invariant(100, 20, 5);", false));
+    }
+    state.SetItemsProcessed(state.iterations() * (100 * 20 + 5));
+}
+BENCHMARK(BM_LoopInvariants)->ArgName("hoist")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Common subexpression elimination: arg 0 with it off, arg 1 on.
+static void BM_CommonSubexpressions(benchmark::State &state) {
+    Interpreter interpreter;
+    OptimizerOptions options;
+    options.eliminateCommonSubexpressions = state.range(0) != 0;
+    interpreter.setOptimizerOptions(options);
+    interpreter.evaluate(workloads::kCommonSubexpressions, false);
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.evaluate("repeated(1000);", false));
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_CommonSubexpressions)->ArgName("cse")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Inlining small functions: arg 0 with it off, arg 1 on.
+static void BM_Inlining(benchmark::State &state) {
+    Interpreter interpreter;
+    OptimizerOptions options;
+    options.inlineSmallFunctions = state.range(0) != 0;
+    interpreter.setOptimizerOptions(options);
+    interpreter.evaluate(workloads::kHelperCalls, false);
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.evaluate("helperCalls(1000);", false));
+    }
+    state.SetItemsProcessed(state.iterations() * 2000);
+}
+BENCHMARK(BM_Inlining)->ArgName("inline")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// The small-calls loop with add1 interpreted as a real call (arg 0), inlined
+// (arg 1), or defined by the host (arg 2).
+static void BM_HostCalls(benchmark::State &state) {
+    Interpreter interpreter(Program::compile(workloads::kSmallCalls));
+    OptimizerOptions options;
+    options.inlineSmallFunctions = state.range(0) == 1;
+    interpreter.setOptimizerOptions(options);
+    if (state.range(0) == 2) {
+        interpreter.defineFunction<int(int)>("add1", [](int x) { return x + 1; });
+    }
+    auto calls = interpreter.function<int(int)>("calls");
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calls(10000));
+    }
+    state.SetItemsProcessed(state.iterations() * 10000);
+}
+BENCHMARK(BM_HostCalls)->ArgName("add1")->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,237 @@
+// bench/NativeComparison.cpp
+//
+// Runs every program in a corpus of file-mode C programs twice: compiled by
+// the system C compiler, and through Interpreter::evaluate(code, true). Checks
+// that main returns the same value both ways and reports how much slower the
+// interpreter is. Exits non-zero if any program disagrees or fails, so it
+// doubles as a correctness oracle for interpreter changes.
+//
+//   VersatileCInterpreterVsNative [--corpus DIR] [--cc COMPILER] [--repetitions N]
+//
+// The native side is timed inside the process (main is renamed and called
+// from a small driver), so process startup doesn't count against it.
+#include "Interpreter.h"
+
+#include <algorithm>
+#include <any>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char *kDriver =
+    "#include <stdio.h>\n"
+    "#include <time.h>\n"
+    "int vci_corpus_main();\n"
+    "int main(void) {\n"
+    "    struct timespec start, end;\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &start);\n"
+    "    int result = vci_corpus_main();\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &end);\n"
+    "    printf(\"%lld\\n\", (long long)(end.tv_sec - start.tv_sec) * 1000000000LL +\n"
+    "                       (end.tv_nsec - start.tv_nsec));\n"
+    "    return result;\n"
+    "}\n";
+
+struct Options {
+    fs::path corpus;
+    std::string compiler;
+    int repetitions = 3;
+};
+
+struct Outcome {
+    int exitStatus = -1;   // what the process reported: main's value & 0xFF
+    double seconds = 0;    // best of the repetitions
+    std::string error;
+};
+
+std::string readFile(const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+std::string quote(const std::string &s) {
+    std::string out = "'";
+    for (char c : s) {
+        out += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return out + "'";
+}
+
+Outcome runNative(const Options &options, const fs::path &source, const fs::path &workDir) {
+    Outcome outcome;
+    fs::path binary = workDir / source.stem();
+    fs::path object = binary;
+    object += ".o";
+    std::string compile = options.compiler + " -O2 -w -Dmain=vci_corpus_main -c -o " + quote(object.string()) +
+                          " " + quote(source.string()) + " && " + options.compiler + " -O2 -o " +
+                          quote(binary.string()) + " " + quote(object.string()) + " " +
+                          quote((workDir / "driver.c").string());
+    if (std::system(compile.c_str()) != 0) {
+        outcome.error = "native compile failed";
+        return outcome;
+    }
+
+    double best = -1;
+    for (int rep = 0; rep < options.repetitions; ++rep) {
+        FILE *pipe = popen(quote(binary.string()).c_str(), "r");
+        if (!pipe) {
+            outcome.error = "could not start native binary";
+            return outcome;
+        }
+        long long ns = -1;
+        if (std::fscanf(pipe, "%lld", &ns) != 1) {
+            ns = -1;
+        }
+        int status = pclose(pipe);
+        if (ns < 0 || !WIFEXITED(status)) {
+            outcome.error = "native run failed";
+            return outcome;
+        }
+        outcome.exitStatus = WEXITSTATUS(status);
+        double seconds = static_cast<double>(ns) / 1e9;
+        best = best < 0 ? seconds : std::min(best, seconds);
+    }
+    outcome.seconds = best;
+    return outcome;
+}
+
+int toInt(const std::any &value) {
+    if (value.type() == typeid(int)) {
+        return std::any_cast<int>(value);
+    }
+    if (value.type() == typeid(char)) {
+        return std::any_cast<char>(value);
+    }
+    if (value.type() == typeid(double)) {
+        return static_cast<int>(std::any_cast<double>(value));
+    }
+    throw std::runtime_error("main did not return a number");
+}
+
+Outcome runInterpreted(const Options &options, const std::string &code) {
+    Outcome outcome;
+    double best = -1;
+    for (int rep = 0; rep < options.repetitions; ++rep) {
+        try {
+            Interpreter interpreter;
+            auto start = std::chrono::steady_clock::now();
+            int result = toInt(interpreter.evaluate(code, true));
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            // A process exit status keeps only the low byte of main's result.
+            outcome.exitStatus = result & 0xFF;
+            best = best < 0 ? elapsed.count() : std::min(best, elapsed.count());
+        } catch (const std::exception &e) {
+            outcome.error = e.what();
+            return outcome;
+        }
+    }
+    outcome.seconds = best;
+    return outcome;
+}
+
+void printUsage(std::ostream &out) {
+    out << "Usage: VersatileCInterpreterVsNative [--corpus DIR] [--cc COMPILER] [--repetitions N]\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+#ifdef VCI_CORPUS_DIR
+    options.corpus = VCI_CORPUS_DIR;
+#else
+    options.corpus = "corpus";
+#endif
+    const char *cc = std::getenv("CC");
+    options.compiler = cc && *cc ? cc : "cc";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--corpus" || arg == "--cc" || arg == "--repetitions") && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (arg == "--corpus") {
+                options.corpus = value;
+            } else if (arg == "--cc") {
+                options.compiler = value;
+            } else {
+                options.repetitions = std::max(1, std::atoi(value.c_str()));
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(std::cout);
+            return 0;
+        } else {
+            printUsage(std::cerr);
+            return 2;
+        }
+    }
+
+    std::vector<fs::path> programs;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(options.corpus, ec)) {
+        if (entry.path().extension() == ".c") {
+            programs.push_back(entry.path());
+        }
+    }
+    if (ec || programs.empty()) {
+        std::cerr << "No .c programs found in " << options.corpus << "\n";
+        return 2;
+    }
+    std::sort(programs.begin(), programs.end());
+
+    fs::path workDir = fs::temp_directory_path() / ("vci_vs_native_" + std::to_string(::getpid()));
+    fs::create_directories(workDir);
+    {
+        std::ofstream driver(workDir / "driver.c");
+        driver << kDriver;
+    }
+
+    std::cout << std::left << std::setw(20) << "program" << std::right << std::setw(8) << "result"
+              << std::setw(14) << "native ms" << std::setw(14) << "interp ms" << std::setw(12) << "slowdown"
+              << "\n";
+    int failures = 0;
+    for (const auto &source : programs) {
+        Outcome native = runNative(options, source, workDir);
+        Outcome interpreted = runInterpreted(options, readFile(source));
+
+        std::cout << std::left << std::setw(20) << source.stem().string() << std::right;
+        if (!native.error.empty() || !interpreted.error.empty()) {
+            std::cout << "  FAILED: " << (native.error.empty() ? "interpreter: " + interpreted.error : native.error)
+                      << "\n";
+            ++failures;
+            continue;
+        }
+        if (native.exitStatus != interpreted.exitStatus) {
+            std::cout << "  MISMATCH: native returned " << native.exitStatus << ", interpreter "
+                      << interpreted.exitStatus << "\n";
+            ++failures;
+            continue;
+        }
+        std::cout << std::setw(8) << native.exitStatus << std::fixed << std::setprecision(3) << std::setw(14)
+                  << native.seconds * 1e3 << std::setw(14) << interpreted.seconds * 1e3 << std::setprecision(0)
+                  << std::setw(11) << interpreted.seconds / std::max(native.seconds, 1e-9) << "x\n";
+    }
+
+    fs::remove_all(workDir, ec);
+    if (failures > 0) {
+        std::cout << failures << " of " << programs.size() << " programs failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+// bench/ParseBenchmarks.cpp
+#include <benchmark/benchmark.h>
+
+#include "IncrementalProgram.h"
+#include "ParseUnit.h"
+#include "PerfCounterReport.h"
+#include "Workloads.h"
+
+// Lexing and parsing only; nothing is executed.
+static void BM_ParseTranslationUnit(benchmark::State &state) {
+    std::string source = workloads::largeProgram(static_cast<int>(state.range(0)));
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        ParseUnit unit(source);
+        benchmark::DoNotOptimize(unit.parseTranslationUnit());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+BENCHMARK(BM_ParseTranslationUnit)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// The editor's path: one function of a large file changes per update.
+static void BM_IncrementalEdit(benchmark::State &state) {
+    const int functions = static_cast<int>(state.range(0));
+    std::string source = workloads::largeProgram(functions);
+    IncrementalProgram program;
+    program.update(source);
+    // Alternate one constant in the middle of the file.
+    size_t pos = source.find("int c = a * ", source.size() / 2) + 12;
+    int edit = 0;
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        source[pos] = static_cast<char>('1' + (edit++ % 7));
+        program.update(source);
+    }
+}
+BENCHMARK(BM_IncrementalEdit)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,39 @@
+// bench/PerfCounterReport.h
+#ifndef BENCH_PERF_COUNTER_REPORT_H
+#define BENCH_PERF_COUNTER_REPORT_H
+
+#include <benchmark/benchmark.h>
+
+#include "PerfCounters.h"
+
+// Adds hardware counters, per iteration, to a benchmark's results (and so to
+// the JSON output). Declare one just before the timing loop; it reads the
+// counters when it goes out of scope. Counters the machine doesn't provide
+// are left out rather than reported as zero.
+class PerfCounterReport {
+public:
+    explicit PerfCounterReport(benchmark::State &state) : state(state) { counters.start(); }
+
+    ~PerfCounterReport() {
+        PerfSample sample = counters.stop();
+        for (int i = 0; i < PerfCounters::CounterCount; ++i) {
+            auto counter = static_cast<PerfCounters::Counter>(i);
+            if (sample[counter]) {
+                state.counters[PerfCounters::counterName(counter)] =
+                    benchmark::Counter(static_cast<double>(*sample[counter]), benchmark::Counter::kAvgIterations);
+            }
+        }
+        if (auto ipc = sample.ipc()) {
+            state.counters["IPC"] = *ipc;
+        }
+    }
+
+    PerfCounterReport(const PerfCounterReport &) = delete;
+    PerfCounterReport &operator=(const PerfCounterReport &) = delete;
+
+private:
+    benchmark::State &state;
+    PerfCounters counters;
+};
+
+#endif // BENCH_PERF_COUNTER_REPORT_H
@@ -0,0 +1,109 @@
+// bench/ReplBenchmarks.cpp
+#include <benchmark/benchmark.h>
+
+#include "Interpreter.h"
+#include "OutputLog.h"
+#include "REPL.h"
+#include "PerfCounterReport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// A long interactive session through REPL::evaluateCommand: declarations,
+// assignments, function definitions and calls, as a user would type them.
+static std::vector<std::string> sessionCommands(int count) {
+    std::vector<std::string> commands;
+    commands.reserve(count);
+    commands.push_back("int square(int v) { return v * v; }");
+    for (int i = 0; static_cast<int>(commands.size()) < count; ++i) {
+        std::string var = "x" + std::to_string(i);
+        commands.push_back("int " + var + " = " + std::to_string(i % 17) + ";");
+        commands.push_back(var + " = " + var + " * 3 + 1;");
+        commands.push_back("square(" + var + ") - " + var + " / 2;");
+    }
+    commands.resize(count);
+    return commands;
+}
+
+static void BM_ReplSession(benchmark::State &state) {
+    auto commands = sessionCommands(static_cast<int>(state.range(0)));
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        REPL repl;
+        for (const auto &command : commands) {
+            benchmark::DoNotOptimize(repl.evaluateCommand(command));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(commands.size()));
+}
+BENCHMARK(BM_ReplSession)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// Latency of single one-line commands in a long-lived session, as a user at
+// the prompt sees it. Reports the median and 99th percentile of the
+// individual evaluations alongside the mean.
+static void BM_ReplLineLatency(benchmark::State &state) {
+    const std::vector<std::string> lines = {
+        "x = x + 1;",
+        "x * 2 + 3;",
+        "int y = x - 1;",
+        "(x + y) / 2;",
+    };
+    Interpreter interpreter;
+    interpreter.evaluate("int x = 0;", false);
+    std::vector<double> samples;
+    samples.reserve(1 << 20);
+    size_t next = 0;
+    for (auto _ : state) {
+        const std::string &line = lines[next++ % lines.size()];
+        auto start = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(interpreter.evaluate(line, false));
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        state.counters["p50_us"] = samples[samples.size() / 2];
+        state.counters["p99_us"] = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    }
+}
+BENCHMARK(BM_ReplLineLatency)->Unit(benchmark::kMicrosecond);
+
+// A script piped through REPL::runPipe, as `VersatileCInterpreter --pipe`
+// runs it: block reads, one evaluation per line, buffered output.
+static void BM_ReplPipe(benchmark::State &state) {
+    std::string script = "int total = 0;\n";
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        script += (i % 2 == 0) ? "total = total + 3;\n" : "total * 2 - 1;\n";
+    }
+    PerfCounterReport perf(state);
+    for (auto _ : state) {
+        std::istringstream in(script);
+        std::ostringstream out;
+        REPL repl;
+        repl.runPipe(in, out);
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReplPipe)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// What the GUI terminal does per frame once a session has produced
+// state.range(0) lines: append a result and fetch one screenful of lines.
+// Should not depend on the session length.
+static void BM_OutputLogFrame(benchmark::State &state) {
+    OutputLog log;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        log.append("> x = x + 1;\n");
+    }
+    for (auto _ : state) {
+        log.append("42\n");
+        size_t visible = 0;
+        for (size_t i = log.lineCount() - 40; i < log.lineCount(); ++i) {
+            visible += log.line(i).size();
+        }
+        benchmark::DoNotOptimize(visible);
+    }
+}
+BENCHMARK(BM_OutputLogFrame)->Arg(1000)->Arg(1000000);
@@ -0,0 +1,246 @@
+// bench/ServerLoad.cpp
+//
+// Load generator for the session server (SessionServer, `--serve`). Opens
+// many sessions, each a closed loop of one outstanding request at a time, and
+// reports throughput and latency percentiles over a fixed duration. Without
+// --socket it starts a server in this process on a temporary socket.
+//
+//   VersatileCInterpreterServerLoad [--socket PATH] [--sessions N] [--seconds S]
+//                                   [--workers N] [--line CODE]
+//
+// Exits non-zero if any request fails or a session is dropped.
+#include "SessionProtocol.h"
+#include "SessionServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socketPath;
+    int sessions = 1000;
+    double seconds = 5.0;
+    unsigned workers = 0;
+    std::string line = "n = n + 1;";
+};
+
+struct Connection {
+    int fd = -1;
+    std::string frame;      // the request, encoded once
+    std::string received;
+    Clock::time_point sentAt;
+    bool waiting = false;
+};
+
+void printUsage(std::ostream &out) {
+    out << "Usage: VersatileCInterpreterServerLoad [--socket PATH] [--sessions N] [--seconds S]\n"
+           "                                       [--workers N] [--line CODE]\n";
+}
+
+// Each session needs a descriptor here (and one in the server, if in-process).
+void raiseDescriptorLimit() {
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+bool sendAll(int fd, const std::string &data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size())));
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--socket" || arg == "--sessions" || arg == "--seconds" || arg == "--workers" ||
+             arg == "--line") && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (arg == "--socket") {
+                options.socketPath = value;
+            } else if (arg == "--sessions") {
+                options.sessions = std::max(1, std::atoi(value.c_str()));
+            } else if (arg == "--seconds") {
+                options.seconds = std::max(0.1, std::atof(value.c_str()));
+            } else if (arg == "--workers") {
+                options.workers = static_cast<unsigned>(std::max(0, std::atoi(value.c_str())));
+            } else {
+                options.line = value;
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(std::cout);
+            return 0;
+        } else {
+            printUsage(std::cerr);
+            return 2;
+        }
+    }
+    raiseDescriptorLimit();
+
+    std::unique_ptr<SessionServer> server;
+    std::thread serverThread;
+    if (options.socketPath.empty()) {
+        options.socketPath = (std::filesystem::temp_directory_path() /
+                              ("vci_server_load_" + std::to_string(::getpid()) + ".sock")).string();
+        SessionServer::Options serverOptions;
+        serverOptions.socketPath = options.socketPath;
+        serverOptions.workers = options.workers;
+        server = std::make_unique<SessionServer>(serverOptions);
+        serverThread = std::thread([&] { server->run(); });
+    }
+
+    int status = 0;
+    try {
+        // Connect every session and give it its variable before timing starts.
+        std::vector<Connection> connections(static_cast<size_t>(options.sessions));
+        for (auto &connection : connections) {
+            connection.fd = session::connectTo(options.socketPath);
+            if (session::request(connection.fd, "int n = 0;", connection.received).status != session::Status::Ok) {
+                throw std::runtime_error("Session setup failed");
+            }
+            ::fcntl(connection.fd, F_SETFL, ::fcntl(connection.fd, F_GETFL) | O_NONBLOCK);
+            session::appendFrame(connection.frame, options.line);
+        }
+
+        int epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        for (size_t i = 0; i < connections.size(); ++i) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = i;
+            ::epoll_ctl(epollFd, EPOLL_CTL_ADD, connections[i].fd, &event);
+        }
+
+        std::vector<double> latenciesUs;
+        latenciesUs.reserve(1 << 20);
+        uint64_t errors = 0, dropped = 0;
+        auto start = Clock::now();
+        auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+        size_t outstanding = 0;
+        for (auto &connection : connections) {
+            connection.sentAt = Clock::now();
+            if (sendAll(connection.fd, connection.frame)) {
+                connection.waiting = true;
+                ++outstanding;
+            } else {
+                ++dropped;
+            }
+        }
+
+        // After the deadline no new requests go out; wait for the rest.
+        std::vector<epoll_event> events(1024);
+        while (outstanding > 0) {
+            int ready = ::epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 1000);
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0) {
+                std::cerr << "Timed out waiting for " << outstanding << " responses\n";
+                dropped += outstanding;
+                break;
+            }
+            for (int e = 0; e < ready; ++e) {
+                Connection &connection = connections[events[e].data.u64];
+                char chunk[4096];
+                ssize_t n;
+                while ((n = ::recv(connection.fd, chunk, sizeof chunk, 0)) > 0) {
+                    connection.received.append(chunk, static_cast<size_t>(n));
+                }
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    if (connection.waiting) {
+                        connection.waiting = false;
+                        --outstanding;
+                        ++dropped;
+                    }
+                    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+                    continue;
+                }
+                std::string_view payload;
+                size_t frameSize = 0;
+                if (!connection.waiting || !session::nextFrame(connection.received, payload, frameSize)) {
+                    continue;
+                }
+                auto now = Clock::now();
+                latenciesUs.push_back(std::chrono::duration<double, std::micro>(now - connection.sentAt).count());
+                if (session::parseResponse(payload).status != session::Status::Ok) {
+                    ++errors;
+                }
+                connection.received.erase(0, frameSize);
+                connection.waiting = false;
+                --outstanding;
+                if (now < deadline) {
+                    connection.sentAt = now;
+                    if (sendAll(connection.fd, connection.frame)) {
+                        connection.waiting = true;
+                        ++outstanding;
+                    } else {
+                        ++dropped;
+                    }
+                }
+            }
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        ::close(epollFd);
+        for (auto &connection : connections) {
+            ::close(connection.fd);
+        }
+
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        std::cout << std::fixed << std::setprecision(1)
+                  << "sessions:    " << options.sessions << "\n"
+                  << "requests:    " << latenciesUs.size() << " in " << elapsed << " s\n"
+                  << "throughput:  " << static_cast<double>(latenciesUs.size()) / elapsed << " requests/s\n"
+                  << "latency us:  p50 " << percentile(latenciesUs, 50) << "  p99 " << percentile(latenciesUs, 99)
+                  << "  p99.9 " << percentile(latenciesUs, 99.9)
+                  << "  max " << (latenciesUs.empty() ? 0.0 : latenciesUs.back()) << "\n"
+                  << "errors:      " << errors << ", dropped: " << dropped << "\n";
+        status = errors == 0 && dropped == 0 ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        status = 1;
+    }
+
+    if (server) {
+        server->stop();
+        serverThread.join();
+    }
+    return status;
+}
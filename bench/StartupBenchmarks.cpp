@@ -0,0 +1,54 @@
+// bench/StartupBenchmarks.cpp
+#include <benchmark/benchmark.h>
+
+#include "Workloads.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Whole-process cost of `VersatileCInterpreter --run file.c` for a small
+// program: exec, static initialisation, mapping and running the file.
+static void BM_CliRunStartup(benchmark::State &state) {
+#ifdef VCI_CLI_PATH
+    std::string program = std::string("/tmp/vci_bench_startup_") + std::to_string(::getpid()) + ".c";
+    {
+        std::ofstream out(program);
+        out << workloads::kFib << "int main() { return fib(10); }\n";
+    }
+    std::string cli = VCI_CLI_PATH;
+    char *argv[] = {cli.data(), const_cast<char *>("--run"), program.data(), nullptr};
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    for (auto _ : state) {
+        pid_t pid = 0;
+        if (posix_spawn(&pid, cli.c_str(), &actions, nullptr, argv, environ) != 0) {
+            state.SkipWithError("could not start " VCI_CLI_PATH);
+            break;
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            state.SkipWithError("--run failed");
+            break;
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    std::remove(program.c_str());
+#else
+    state.SkipWithError("built without the CLI");
+    for (auto _ : state) {
+    }
+#endif
+}
+BENCHMARK(BM_CliRunStartup)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,103 @@
+// bench/Workloads.h
+#ifndef BENCH_WORKLOADS_H
+#define BENCH_WORKLOADS_H
+
+#include <string>
+
+// C sources shared by the benchmarks. Each is deterministic, so results are
+// comparable between runs and machines.
+namespace workloads {
+
+inline const char *kFib =
+    "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n";
+
+inline const char *kFactorial =
+    "double factorial(int n) { if (n < 2) { return 1.0; } return n * factorial(n - 1); }\n";
+
+// sum over an n x n grid; the body is a handful of arithmetic nodes.
+inline const char *kNestedLoops =
+    "int grid(int n) {\n"
+    "    int sum = 0;\n"
+    "    for (int i = 0; i < n; i = i + 1) {\n"
+    "        for (int j = 0; j < n; j = j + 1) {\n"
+    "            sum = sum + i * j - (i + j) / 2;\n"
+    "        }\n"
+    "    }\n"
+    "    return sum;\n"
+    "}\n";
+
+// n calls of a one-line function from a while loop.
+inline const char *kSmallCalls =
+    "int add1(int x) { return x + 1; }\n"
+    "int calls(int n) { int i = 0; int s = 0; while (i < n) { s = add1(s); i = i + 1; } return s; }\n";
+
+// A loop whose bound and body keep recomputing values it never changes,
+// including a call to a pure function.
+inline const char *kLoopInvariants =
+    "int scale(int x) { return x * 3 + 1; }\n"
+    "int invariant(int n, int m, int k) {\n"
+    "    int i = 0;\n"
+    "    int s = 0;\n"
+    "    while (i < n * m + k) { s = s + scale(m) * (n - k); i = i + 1; }\n"
+    "    return s;\n"
+    "}\n";
+
+// A loop body that computes the same expressions of its counter several
+// times, in one statement and across statements.
+inline const char *kCommonSubexpressions =
+    "int repeated(int n) {\n"
+    "    int i = 0;\n"
+    "    int s = 0;\n"
+    "    while (i < n) {\n"
+    "        int d = (i + 1) * (i + 2);\n"
+    "        s = s + (i + 1) * (i + 2) - d / (i + 1);\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    return s;\n"
+    "}\n";
+
+// A loop whose body is mostly calls to small helper functions.
+inline const char *kHelperCalls =
+    "int sq(int x) { return x * x; }\n"
+    "double avg(int a, int b) { return (a + b) / 2.0; }\n"
+    "int helperCalls(int n) {\n"
+    "    int i = 0;\n"
+    "    double s = 0.0;\n"
+    "    while (i < n) { s = s + avg(sq(i), i); i = i + 1; }\n"
+    "    return s;\n"
+    "}\n";
+
+// A function whose body nests `depth` blocks and reads a global from the
+// innermost one, so every lookup walks the whole scope chain.
+inline std::string deepScopes(int depth) {
+    std::string src = "int seed = 3;\nint deep(int n) {\n int total = 0;\n int k = 0;\n while (k < n) {\n";
+    for (int d = 0; d < depth; ++d) {
+        src += "{ int v" + std::to_string(d) + " = " + std::to_string(d) + ";\n";
+    }
+    src += "total = total + seed;\n";
+    for (int d = 0; d < depth; ++d) {
+        src += "}\n";
+    }
+    src += "k = k + 1;\n }\n return total;\n}\n";
+    return src;
+}
+
+// A translation unit of `functions` small functions plus main, for parsing.
+inline std::string largeProgram(int functions) {
+    std::string src = "int counter = 0;\n";
+    for (int f = 0; f < functions; ++f) {
+        std::string name = "f" + std::to_string(f);
+        src += "int " + name + "(int a, int b) {\n"
+               "    int c = a * " + std::to_string(f % 7 + 1) + " + b;\n"
+               "    if (c > 100) { c = c - 100; } else { c = c + 1; }\n"
+               "    while (c > 10) { c = c / 2; }\n"
+               "    return c;\n"
+               "}\n";
+    }
+    src += "int main() { return f0(1, 2); }\n";
+    return src;
+}
+
+} // namespace workloads
+
+#endif // BENCH_WORKLOADS_H
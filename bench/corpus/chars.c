@@ -0,0 +1,22 @@
+// char arithmetic and conversions between char and int.
+char shift(char c, int by) {
+    int offset = c - 'a';
+    offset = offset + by;
+    offset = offset - (offset / 26) * 26;
+    char shifted = 'a' + offset;
+    return shifted;
+}
+
+int main() {
+    int checksum = 0;
+    for (int round = 0; round < 200; round = round + 1) {
+        char c = 'a';
+        int k = 0;
+        while (k < 26) {
+            c = shift(c, round);
+            checksum = checksum + c;
+            k = k + 1;
+        }
+    }
+    return checksum / 100;
+}
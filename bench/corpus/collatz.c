@@ -0,0 +1,24 @@
+// Longest Collatz chain: data-dependent branching in a while loop.
+int chainLength(int n) {
+    int steps = 0;
+    while (n != 1) {
+        if (n - (n / 2) * 2 == 0) {
+            n = n / 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        steps = steps + 1;
+    }
+    return steps;
+}
+
+int main() {
+    int best = 0;
+    for (int n = 1; n < 1000; n = n + 1) {
+        int length = chainLength(n);
+        if (length > best) {
+            best = length;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,22 @@
+// Euclid's algorithm over all pairs, with a global accumulator.
+int calls = 0;
+
+int gcd(int a, int b) {
+    calls = calls + 1;
+    while (b != 0) {
+        int t = a - (a / b) * b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int main() {
+    int sum = 0;
+    for (int a = 1; a < 60; a = a + 1) {
+        for (int b = 1; b < 60; b = b + 1) {
+            sum = sum + gcd(a, b);
+        }
+    }
+    return sum / calls;
+}
@@ -0,0 +1,10 @@
+// Tight nested loops over integer arithmetic.
+int main() {
+    int sum = 0;
+    for (int i = 0; i < 150; i = i + 1) {
+        for (int j = 0; j < 150; j = j + 1) {
+            sum = sum + i * j - (i + j) / 3;
+        }
+    }
+    return sum / 1000;
+}
@@ -0,0 +1,19 @@
+// Floating point: Newton's method for square roots, summed.
+double root(double x) {
+    double guess = x / 2.0;
+    int i = 0;
+    while (i < 20) {
+        guess = (guess + x / guess) / 2.0;
+        i = i + 1;
+    }
+    return guess;
+}
+
+int main() {
+    double total = 0.0;
+    for (int n = 1; n < 300; n = n + 1) {
+        total = total + root(n);
+    }
+    int scaled = total / 10.0;
+    return scaled;
+}
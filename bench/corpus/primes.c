@@ -0,0 +1,22 @@
+// Trial division; the language has no %, so remainders are spelled out.
+int isPrime(int n) {
+    if (n < 2) {
+        return 0;
+    }
+    int d = 2;
+    while (d * d <= n) {
+        if (n - (n / d) * d == 0) {
+            return 0;
+        }
+        d = d + 1;
+    }
+    return 1;
+}
+
+int main() {
+    int count = 0;
+    for (int n = 0; n < 3000; n = n + 1) {
+        count = count + isPrime(n);
+    }
+    return count;
+}
@@ -0,0 +1,140 @@
+// AllocationTracker.cpp
+#include "AllocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+#include <ostream>
+
+namespace {
+
+// Plain data with a constant initialiser, so reading it from operator new
+// never triggers thread_local initialisation (which could itself allocate).
+thread_local AllocationCounts threadCounts;
+
+} // namespace
+
+namespace allocations {
+
+bool enabled() {
+#ifdef VCI_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationCounts threadTotals() {
+    return threadCounts;
+}
+
+} // namespace allocations
+
+void writeAllocations(std::ostream &out, const EvaluationAllocations &counts) {
+    auto phase = [&out](const char *name, const AllocationCounts &c) {
+        out << name << ": " << c.allocations << " allocations, " << c.bytes << " bytes";
+    };
+    phase("lex", counts.lex);
+    out << "; ";
+    phase("parse", counts.parse);
+    out << "; ";
+    phase("execute", counts.execute);
+}
+
+#ifdef VCI_TRACK_ALLOCATIONS
+
+// Replacements for the global allocation functions. The standard library's
+// nothrow variants forward to these.
+namespace {
+
+void *allocate(std::size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+    for (;;) {
+        if (void *p = std::malloc(size)) {
+            ++threadCounts.allocations;
+            threadCounts.bytes += size;
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void *allocateAligned(std::size_t size, std::align_val_t alignment) {
+    auto align = static_cast<std::size_t>(alignment);
+    if (align < sizeof(void *)) {
+        align = sizeof(void *);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    for (;;) {
+        void *p = nullptr;
+        if (posix_memalign(&p, align, size) == 0) {
+            ++threadCounts.allocations;
+            threadCounts.bytes += size;
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return allocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+#endif // VCI_TRACK_ALLOCATIONS
@@ -0,0 +1,131 @@
+#include "Builtins.h"
+
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+[[noreturn]] void fail(std::string_view name, const std::string &message) {
+    throw std::runtime_error(std::string(name) + ": " + message);
+}
+
+template<typename T>
+T numberArgument(std::string_view name, const BuiltinArgument &arg) {
+    const auto *value = std::get_if<VarValue>(&arg);
+    if (!value) {
+        fail(name, "expected a number, not a string literal");
+    }
+    return std::visit([](auto v) { return static_cast<T>(v); }, *value);
+}
+
+std::string_view stringArgument(std::string_view name, const BuiltinArgument &arg) {
+    const auto *text = std::get_if<std::string_view>(&arg);
+    if (!text) {
+        fail(name, "expected a string literal");
+    }
+    return *text;
+}
+
+void expectArguments(std::string_view name, std::span<const BuiltinArgument> args, size_t count) {
+    if (args.size() != count) {
+        fail(name, "expects " + std::to_string(count) + " argument" + (count == 1 ? "" : "s") +
+                   " but got " + std::to_string(args.size()));
+    }
+}
+
+int formatPrintf(std::string_view name, std::span<const BuiltinArgument> args, ProgramOutput &out) {
+    if (args.empty()) {
+        fail(name, "expects a format string");
+    }
+    std::string_view format = stringArgument(name, args[0]);
+    const uint64_t start = out.written();
+    size_t next = 1;
+    while (!format.empty()) {
+        // Plain text up to the next conversion goes out in one piece.
+        size_t percent = format.find('%');
+        out.write(format.substr(0, percent));
+        if (percent == std::string_view::npos || percent + 1 == format.size()) {
+            if (percent != std::string_view::npos) {
+                fail(name, "format ends in '%'");
+            }
+            break;
+        }
+        char conversion = format[percent + 1];
+        format.remove_prefix(percent + 2);
+        if (conversion == '%') {
+            out.put('%');
+            continue;
+        }
+        if (next == args.size()) {
+            fail(name, std::string("no argument for %") + conversion);
+        }
+        const BuiltinArgument &arg = args[next++];
+        switch (conversion) {
+            case 'd': out.writeInt(numberArgument<int>(name, arg)); break;
+            case 'f': out.writeDouble(numberArgument<double>(name, arg)); break;
+            case 'c': out.put(numberArgument<char>(name, arg)); break;
+            case 's': out.write(stringArgument(name, arg)); break;
+            default:  fail(name, std::string("unsupported conversion %") + conversion);
+        }
+    }
+    // Like C, extra arguments are evaluated and ignored.
+    return static_cast<int>(out.written() - start);
+}
+
+} // namespace
+
+std::optional<Builtin> findBuiltin(std::string_view name) {
+    if (name == "printf") {
+        return Builtin::Printf;
+    }
+    if (name == "putchar") {
+        return Builtin::Putchar;
+    }
+    if (name == "puts") {
+        return Builtin::Puts;
+    }
+    return std::nullopt;
+}
+
+VarValue callBuiltin(Builtin builtin, std::string_view name, std::span<const BuiltinArgument> args,
+                     ProgramOutput &out) {
+    switch (builtin) {
+        case Builtin::Printf:
+            return formatPrintf(name, args, out);
+        case Builtin::Putchar: {
+            expectArguments(name, args, 1);
+            char c = numberArgument<char>(name, args[0]);
+            out.put(c);
+            return static_cast<int>(static_cast<unsigned char>(c));
+        }
+        case Builtin::Puts:
+            expectArguments(name, args, 1);
+            out.write(stringArgument(name, args[0]));
+            out.put('\n');
+            return 0;
+    }
+    throw std::runtime_error("Unknown builtin");
+}
+
+std::string decodeStringLiteral(std::string_view token) {
+    std::string text;
+    if (token.size() < 2) {
+        return text;
+    }
+    token = token.substr(1, token.size() - 2);
+    text.reserve(token.size());
+    for (size_t i = 0; i < token.size(); ++i) {
+        if (token[i] != '\\' || i + 1 == token.size()) {
+            text.push_back(token[i]);
+            continue;
+        }
+        switch (char escaped = token[++i]) {
+            case 'n': text.push_back('\n'); break;
+            case 't': text.push_back('\t'); break;
+            case 'r': text.push_back('\r'); break;
+            case '0': text.push_back('\0'); break;
+            default:  text.push_back(escaped); break; // \\, \", \' and anything else
+        }
+    }
+    return text;
+}
@@ -0,0 +1,38 @@
+// Builtins.h
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "ProgramOutput.h"
+#include "Variable.h"
+
+// Functions every program can call without defining them. They print to the
+// interpreter's ProgramOutput, and their names cannot be used for functions.
+enum class Builtin { Printf, Putchar, Puts };
+
+std::optional<Builtin> findBuiltin(std::string_view name);
+
+// An argument to a builtin: a value, or the text of a string literal (the
+// language has no string values; literals can only be passed to builtins).
+using BuiltinArgument = std::variant<VarValue, std::string_view>;
+constexpr size_t kMaxBuiltinArguments = 16;
+
+// Runs `builtin` and returns what its C namesake does: the number of
+// characters printf wrote, the character putchar wrote, and 0 from puts.
+// printf supports %d, %f, %c, %s (string literals only) and %%, without flags,
+// width or precision. Throws std::runtime_error for wrong arguments or an
+// unsupported conversion.
+VarValue callBuiltin(Builtin builtin, std::string_view name, std::span<const BuiltinArgument> args,
+                     ProgramOutput &out);
+
+// The text of a string literal token (quotes included) with its escapes
+// (\n, \t, \r, \0, \\, \", \') decoded.
+std::string decodeStringLiteral(std::string_view token);
+
+#endif // BUILTINS_H
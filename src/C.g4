@@ -162,6 +162,7 @@ primaryExpression
 literal
     : Number                        # NumberLiteral
     | CharLiteral                   # CharLiteral
+    | StringLiteral                 # StringLiteral
     ;
 
 // Program components
@@ -203,6 +204,8 @@ GTE     : '>=';
 NOT     : '!';
 
 CharLiteral : '\'' . '\'' ;
+// Only for builtins (see Builtins.h); escapes are decoded after parsing.
+StringLiteral : '"' (~["\\\r\n] | '\\' .)* '"' ;
 IDENTIFIER  : [a-zA-Z_][a-zA-Z0-9_]* ;
 Number
     : [0-9]+ ('.' [0-9]+)?                 // Integer or floating-point number
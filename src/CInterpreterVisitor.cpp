@@ -7,12 +7,16 @@
 #include <CLexer.h>
 
 #include "CParser.h"
+#include <algorithm>
+#include <array>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include "antlr4-runtime.h"
 #include "EnvScopeGuard.h"
 #include "Utils.h"
 #include "ReturnException.h"
+#include "Trace.h"
 
 // Single-arg ctor: no token stream available
 CInterpreterVisitor::CInterpreterVisitor(Environment* environment)
@@ -23,17 +27,25 @@ CInterpreterVisitor::CInterpreterVisitor(Environment* environment,
                                          antlr4::CommonTokenStream* toks)
   : env(environment), tokens(toks) {}
 
+// Unit ctor: the token stream comes from the unit, which we share with any
+// functions defined while visiting its tree.
+CInterpreterVisitor::CInterpreterVisitor(Environment* environment,
+                                         std::shared_ptr<ParseUnit> parseUnit)
+  : env(environment), tokens(parseUnit->tokenStream()), unit(std::move(parseUnit)),
+    plan(unit->optimizationPlan()), unitId(unit->id()) {}
+
 
 // Destructor definition
 CInterpreterVisitor::~CInterpreterVisitor() {
     // Any cleanup if needed
 }
 
-#define LOG(x) std::clog << x << std::endl;
-
-
 
 std::any CInterpreterVisitor::visitAddSubExpression(CParser::AddSubExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     VarValue left = std::any_cast<VarValue>(visit(ctx->multiplicativeExpression(0))); // First term
 
     for (size_t i = 0; i < ctx->addOp().size(); i++) {
@@ -51,6 +63,9 @@ std::any CInterpreterVisitor::visitAddSubExpression(CParser::AddSubExpressionCon
         }, left, right);
     }
 
+    if (slot) {
+        *slot = left;
+    }
     return std::any(left);
 }
 
@@ -58,6 +73,10 @@ std::any CInterpreterVisitor::visitAddSubExpression(CParser::AddSubExpressionCon
 
 
 std::any CInterpreterVisitor::visitMulDivExpression(CParser::MulDivExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     VarValue left = std::any_cast<VarValue>(visit(ctx->unaryExpression(0)));
 
     for (size_t i = 0; i < ctx->mulOp().size(); i++) {
@@ -75,14 +94,24 @@ std::any CInterpreterVisitor::visitMulDivExpression(CParser::MulDivExpressionCon
             }
         }, left, right);
     }
+    if (slot) {
+        *slot = left;
+    }
     return std::any(left);
 }
 
 std::any CInterpreterVisitor::visitUnaryMinusExpression(CParser::UnaryMinusExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     VarValue value = std::any_cast<VarValue>(visit(ctx->unaryExpression()));
     value = std::visit([](auto a) -> VarValue {
         return -a;
     }, value);
+    if (slot) {
+        *slot = value;
+    }
     return std::any(value);
 }
 
@@ -126,6 +155,10 @@ std::any CInterpreterVisitor::visitCharLiteral(CParser::CharLiteralContext *ctx)
     return std::any(result);
 }
 
+std::any CInterpreterVisitor::visitStringLiteral(CParser::StringLiteralContext *) {
+    throw std::runtime_error("String literals can only be passed to printf and puts.");
+}
+
 std::any CInterpreterVisitor::aggregateResult(std::any aggregate, std::any nextResult) {
     if (!nextResult.has_value()) {
         return aggregate;
@@ -143,6 +176,10 @@ std::any CInterpreterVisitor::visitReturnStmt(CParser::ReturnStmtContext *ctx) {
 }
 
 std::any CInterpreterVisitor::visitLogicalOrExpression(CParser::LogicalOrExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     // Evaluate the first operand.
     VarValue result = std::any_cast<VarValue>(visit(ctx->logicalAndExpression(0)));
 
@@ -164,11 +201,18 @@ std::any CInterpreterVisitor::visitLogicalOrExpression(CParser::LogicalOrExpress
         // Store the result back as a VarValue (an int).
         result = combined;
     }
+    if (slot) {
+        *slot = result;
+    }
     return std::any(result);
 }
 
 
 std::any CInterpreterVisitor::visitLogicalAndExpression(CParser::LogicalAndExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     // Evaluate the first operand.
     VarValue result = std::any_cast<VarValue>(visit(ctx->equalityExpression(0)));
 
@@ -186,10 +230,17 @@ std::any CInterpreterVisitor::visitLogicalAndExpression(CParser::LogicalAndExpre
         int combined = (leftBool && rightBool) ? 1 : 0;
         result = combined;
     }
+    if (slot) {
+        *slot = result;
+    }
     return std::any(result);
 }
 
 std::any CInterpreterVisitor::visitEqualityExpression(CParser::EqualityExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     // Evaluate the first relational expression.
     VarValue left = std::any_cast<VarValue>(visit(ctx->relationalExpression(0)));
 
@@ -209,11 +260,18 @@ std::any CInterpreterVisitor::visitEqualityExpression(CParser::EqualityExpressio
             }
         }, left, right);
     }
+    if (slot) {
+        *slot = left;
+    }
     return std::any(left);
 }
 
 
 std::any CInterpreterVisitor::visitRelationalExpression(CParser::RelationalExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     VarValue left = std::any_cast<VarValue>(visit(ctx->additiveExpression(0)));
 
     // For each relational operator and right-hand additive expression, apply the operator.
@@ -238,6 +296,9 @@ std::any CInterpreterVisitor::visitRelationalExpression(CParser::RelationalExpre
         }, left, right);
     }
 
+    if (slot) {
+        *slot = left;
+    }
     // Return the result wrapped in std::any.
     return std::any(left);
 }
@@ -245,6 +306,10 @@ std::any CInterpreterVisitor::visitRelationalExpression(CParser::RelationalExpre
 
 
 std::any CInterpreterVisitor::visitLogicalNotExpression(CParser::LogicalNotExpressionContext *ctx) {
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
     // Evaluate the operand of the '!' operator.
     VarValue operand = std::any_cast<VarValue>(visit(ctx->unaryExpression()));
 
@@ -254,6 +319,9 @@ std::any CInterpreterVisitor::visitLogicalNotExpression(CParser::LogicalNotExpre
         return (v != 0) ? 0 : 1;
     }, operand);
 
+    if (slot) {
+        *slot = VarValue(boolResult);
+    }
     // Return the Boolean result wrapped in a VarValue.
     return std::any(VarValue(boolResult));
 }
@@ -363,9 +431,12 @@ std::any CInterpreterVisitor::visitIfElseStatement(CParser::IfElseStatementConte
 }
 
 std::any CInterpreterVisitor::visitWhileStatement(CParser::WhileStatementContext *ctx) {
+    ReuseScope invariants(*this);
+    invariants.armLoop(ctx);
     // Evaluate the condition expression and convert to bool.
     while (convertToBool(std::any_cast<VarValue>(visit(ctx->expression())))) {
-        // Execute the loop body.
+        // Safe point, then execute the loop body.
+        checkpoint();
         visit(ctx->statement());
     }
     // Return an empty std::any since the loop itself produces no value.
@@ -373,19 +444,20 @@ std::any CInterpreterVisitor::visitWhileStatement(CParser::WhileStatementContext
 }
 
 std::any CInterpreterVisitor::visitDoWhileStatement(CParser::DoWhileStatementContext *ctx) {
+    ReuseScope invariants(*this);
+    invariants.armLoop(ctx);
     do {
+        checkpoint();
         visit(ctx->statement());
     } while (convertToBool(std::any_cast<VarValue>(visit(ctx->expression()))));
     return std::any();
 }
 
 std::any CInterpreterVisitor::visitForStatement(CParser::ForStatementContext *ctx) {
-    LOG("Entering for loop.");
-    // Push a new scope for the for loop.
-    Environment* loopEnv = env->pushScope();
-    Environment* previousEnv = env;
-    env = loopEnv;
-    LOG("New loop scope pushed.");
+    TRACE(VCI_TRACE_DEBUG, TraceEvent::ForEnter, static_cast<int64_t>(ctx->getStart()->getLine()));
+    // Push a new scope for the for loop; it is popped on exit, including when
+    // the body returns, fails or is cancelled.
+    EnvScopeGuard guard(env);
 
     // Get the forLoop components.
     ForLoopComponents comps = std::any_cast<ForLoopComponents>(visit(ctx->forCondition()));
@@ -393,19 +465,13 @@ std::any CInterpreterVisitor::visitForStatement(CParser::ForStatementContext *ct
     // --- Initializer ---
     if (comps.initializer.has_value()) {
         if (comps.initializer.type() == typeid(CParser::ForDeclarationContext*)) {
-            auto declCtx = std::any_cast<CParser::ForDeclarationContext*>(comps.initializer);
-            LOG("Running for loop initializer (declaration): " << declCtx->getText());
-            visit(declCtx);
+            visit(std::any_cast<CParser::ForDeclarationContext*>(comps.initializer));
         } else if (comps.initializer.type() == typeid(CParser::ExpressionContext*)) {
-            auto exprCtx = std::any_cast<CParser::ExpressionContext*>(comps.initializer);
-            LOG("Running for loop initializer (expression): " << exprCtx->getText());
-            visit(exprCtx);
-        } else {
-            LOG("Unknown initializer type.");
+            visit(std::any_cast<CParser::ExpressionContext*>(comps.initializer));
         }
-    } else {
-        LOG("No initializer provided.");
     }
+    ReuseScope invariants(*this);
+    invariants.armLoop(ctx);
 
 
     // --- Condition ---
@@ -415,31 +481,27 @@ std::any CInterpreterVisitor::visitForStatement(CParser::ForStatementContext *ct
         if (auto condCtx = std::any_cast<CParser::ForConditionExpressionContext*>(comps.condition); condCtx != nullptr) {
             std::any condResult = visit(condCtx);
             condition = convertToBool(std::any_cast<VarValue>(condResult));
-            LOG("Initial condition evaluated from expression: " << (condition ? "true" : "false"));
         } else {
             // Otherwise, assume it's an explicit VarValue.
             condition = convertToBool(std::any_cast<VarValue>(comps.condition));
-            LOG("Initial condition evaluated as explicit true value: " << (condition ? "true" : "false"));
         }
-    } else {
-        condition = true;
-        LOG("No condition provided; defaulting to true.");
     }
 
     // --- Loop Body and Update ---
+    int64_t iterations = 0;
     while (condition) {
-        LOG("Loop iteration begins. Condition is true.");
-        // Execute the loop body.
+        TRACE(VCI_TRACE_DEBUG, TraceEvent::ForIteration, static_cast<int64_t>(ctx->getStart()->getLine()),
+              iterations);
+        ++iterations;
+        // Safe point, then execute the loop body.
+        checkpoint();
         visit(ctx->statement());
 
         // Process the update part, if provided.
         if (comps.update.has_value()) {
             if (auto updateCtx = std::any_cast<CParser::ForUpdateExpressionContext*>(comps.update); updateCtx != nullptr) {
-                LOG("Executing update expression: " << updateCtx->getText());
                 visit(updateCtx);
             }
-        } else {
-            LOG("No update expression provided.");
         }
 
         // Reevaluate the condition.
@@ -447,29 +509,20 @@ std::any CInterpreterVisitor::visitForStatement(CParser::ForStatementContext *ct
             if (auto condCtx = std::any_cast<CParser::ForConditionExpressionContext*>(comps.condition); condCtx != nullptr) {
                 std::any condResult = visit(condCtx);
                 condition = convertToBool(std::any_cast<VarValue>(condResult));
-                LOG("Reevaluated condition from expression: " << (condition ? "true" : "false"));
             } else {
                 condition = convertToBool(std::any_cast<VarValue>(comps.condition));
-                LOG("Reevaluated condition from explicit value: " << (condition ? "true" : "false"));
             }
         } else {
             condition = true;
-            LOG("No condition; defaulting to true.");
         }
     }
-    LOG("For loop finished; condition is false. Exiting loop.");
-
-    // Pop the scope when done.
-    env = env->popScope();
-    delete loopEnv; // or handle via smart pointers
-    LOG("Loop scope popped. Exiting for loop.");
+    TRACE(VCI_TRACE_DEBUG, TraceEvent::ForExit, static_cast<int64_t>(ctx->getStart()->getLine()), iterations);
 
     // The for loop itself does not produce a meaningful value.
     return std::any();
 }
 
 std::any CInterpreterVisitor::visitForCondition(CParser::ForConditionContext *ctx) {
-    LOG("Entered visitForCondition.");
     ForLoopComponents comps;
 
     // Initializer: either a forDeclaration or an expression.
@@ -495,10 +548,6 @@ std::any CInterpreterVisitor::visitForCondition(CParser::ForConditionContext *ct
     } else {
         comps.update = std::any();
     }
-    LOG("Exiting visitForCondition with components: "
-            << "Initializer: " << (comps.initializer.has_value() ? "set" : "empty")
-            << ", Condition: " << (comps.condition.has_value() ? "set" : "empty")
-            << ", Update: " << (comps.update.has_value() ? "set" : "empty"));
     return comps;
 }
 
@@ -511,10 +560,15 @@ std::any CInterpreterVisitor::visitCompoundStatement(CParser::CompoundStatementC
     // RAII guard: on construction it does env = env->pushScope(),
     // on destruction it pops back to the parent.
     EnvScopeGuard guard(env);
+    ReuseScope repeats(*this);
+    repeats.armBlock(ctx);
 
     std::any lastValue;
     // first process any declarations
     for (auto *declCtx : ctx->declaration()) {
+        if (profiler) {
+            profiler->hitLine(unitId, declCtx->getStart()->getLine());
+        }
         lastValue = visit(declCtx);
     }
     // then run all the statements
@@ -528,6 +582,20 @@ std::any CInterpreterVisitor::visitCompoundStatement(CParser::CompoundStatementC
 
 
 
+std::any CInterpreterVisitor::visitReplInput(CParser::ReplInputContext *ctx) {
+    ReuseScope repeats(*this);
+    repeats.armBlock(ctx);
+    return CBaseVisitor::visitReplInput(ctx);
+}
+
+std::any CInterpreterVisitor::visitStatement(CParser::StatementContext *ctx) {
+    // Blocks only group statements; their contents are counted instead.
+    if (profiler && !ctx->compoundStatement()) {
+        profiler->hitLine(unitId, ctx->getStart()->getLine());
+    }
+    return CBaseVisitor::visitStatement(ctx);
+}
+
 std::any CInterpreterVisitor::visitParenthesizedExpression(CParser::ParenthesizedExpressionContext *ctx) {
     return visit(ctx->expression());
 }
@@ -560,7 +628,14 @@ VarValue CInterpreterVisitor::processDeclaration(CParser::TypeSpecifierContext*
     VarValue varValue;
     if (exprCtx != nullptr) {
         std::any initResult = visit(exprCtx);
-        varValue = std::any_cast<VarValue>(initResult);
+        // Convert to the declared type, as C does (`int i = 2.5;` stores 2).
+        varValue = std::visit([&](auto a) -> VarValue {
+            switch (varType) {
+                case VarType::INT:    return static_cast<int>(a);
+                case VarType::CHAR:   return static_cast<char>(a);
+                default:              return static_cast<double>(a);
+            }
+        }, std::any_cast<VarValue>(initResult));
     } else {
         // Default initialization based on type.
         if (varType == VarType::INT) {
@@ -589,6 +664,9 @@ std::any CInterpreterVisitor::visitFunctionDefinition(CParser::FunctionDefinitio
 
     // --- 2. Extract name + return type ---
     std::string funcName      = ctx->IDENTIFIER()->getText();
+    if (findBuiltin(funcName)) {
+        throw std::runtime_error("'" + funcName + "' is a builtin function and cannot be redefined.");
+    }
     std::string returnTypeStr = ctx->typeSpecifier()->getText();
     VarType    returnType     = toVarType(returnTypeStr);
 
@@ -620,9 +698,14 @@ std::any CInterpreterVisitor::visitFunctionDefinition(CParser::FunctionDefinitio
     func.parameterTypes = std::move(paramTypes); // the types vector
     func.parameterNames = std::move(paramNames); // the names vector
     func.bodyText       = std::move(bodyText);
+    if (unit) {
+        // The tree outlives this visit, so keep the parsed body around.
+        func.parsed.tree = ctx->compoundStatement();
+        func.parsed.unit = unit;
+    }
 
     // --- 6. Register it and return void ---
-    env->defineFunction(funcName, func);
+    env->defineFunction(funcName, compileFunction(std::move(func)));
     return std::any();
 }
 
@@ -632,9 +715,18 @@ std::any CInterpreterVisitor::visitPostfixExpression(CParser::PostfixExpressionC
         return visit(ctx->primaryExpression());
     }
 
-    // 2) Look up the function in the environment:
+    auto *slot = reuseSlot(ctx);
+    if (slot && *slot) {
+        return std::any(**slot);
+    }
+
+    // 2) Builtins first (their names cannot be redefined), then the
+    // functions in the environment:
     std::string funcName = ctx->primaryExpression()->getText();
-    Function* func = env->getFunction(funcName);
+    if (auto builtin = findBuiltin(funcName)) {
+        return std::any(invokeBuiltin(*builtin, funcName, ctx));
+    }
+    const Function* func = env->getFunction(funcName);
     if (!func) {
         throw std::runtime_error("Function '" + funcName + "' is not defined.");
     }
@@ -648,90 +740,237 @@ std::any CInterpreterVisitor::visitPostfixExpression(CParser::PostfixExpressionC
         }
     }
 
-    // 4) Check arity:
-    auto &paramNames = func->parameterNames;
-    auto &paramTypes = func->parameterTypes;
-    if (rawArgs.size() != paramNames.size()) {
+    // Small bodies run in place, unless profiling (which counts calls), the
+    // function calls itself, or inlined calls are already nested too deep.
+    const FunctionBody &body = func->compiled();
+    bool inlined = body.inlineBody && optimizer.inlineSmallFunctions && !profiler &&
+                   inlineDepth < kMaxInlineDepth &&
+                   !std::ranges::binary_search(body.effects.callees, funcName);
+    VarValue result = inlined ? inlineCall(funcName, *func, rawArgs) : callFunction(funcName, *func, rawArgs);
+    if (slot) {
+        *slot = result;
+    }
+    return std::any(result);
+}
+
+VarValue CInterpreterVisitor::invokeBuiltin(Builtin builtin, const std::string &name,
+                                            CParser::PostfixExpressionContext *ctx) {
+    checkpoint();
+    // A fixed array, so the call itself allocates nothing.
+    std::array<BuiltinArgument, kMaxBuiltinArguments> args;
+    size_t count = 0;
+    if (auto *argList = ctx->argumentExpressionList(0)) {
+        for (auto *child : argList->children) {
+            auto *arg = dynamic_cast<CParser::AssignmentExpressionContext *>(child);
+            if (!arg) {
+                continue; // a comma
+            }
+            if (count == args.size()) {
+                throw std::runtime_error(name + ": at most " + std::to_string(kMaxBuiltinArguments) +
+                                         " arguments are supported");
+            }
+            const std::string *text = plan ? plan->stringArgument(arg) : nullptr;
+            args[count++] = text ? BuiltinArgument(std::string_view(*text))
+                                 : BuiltinArgument(std::any_cast<VarValue>(visit(arg)));
+        }
+    }
+    std::span<const BuiltinArgument> used(args.data(), count);
+    if (!output) {
+        ProgramOutput discarded;
+        return callBuiltin(builtin, name, used, discarded);
+    }
+    return callBuiltin(builtin, name, used, *output);
+}
+
+namespace {
+
+void checkArity(const std::string &funcName, const Function &func, size_t argCount) {
+    if (argCount != func.parameterNames.size()) {
         throw std::runtime_error(
           "Function '" + funcName +
-          "' expects " + std::to_string(paramNames.size()) +
-          " arguments but got " + std::to_string(rawArgs.size()));
+          "' expects " + std::to_string(func.parameterNames.size()) +
+          " arguments but got " + std::to_string(argCount));
     }
+}
+
+// Converts argument i to its parameter's declared type.
+VarValue toParameterType(VarType expected, const VarValue &v, size_t i) {
+    return std::visit([&](auto a) -> VarValue {
+        using A = decltype(a);
+        if constexpr (!std::is_arithmetic_v<A>) {
+            throw std::runtime_error("Non-arithmetic argument for parameter " + std::to_string(i));
+        }
+        switch (expected) {
+            case VarType::INT:    return static_cast<int>(a);
+            case VarType::DOUBLE: return static_cast<double>(a);
+            case VarType::CHAR:   return static_cast<char>(a);
+        }
+        throw std::runtime_error("Unknown parameter type");
+    }, v);
+}
+
+// Converts the body's result to the declared return type.
+VarValue toReturnType(VarType returnType, const VarValue &rawRet) {
+    return std::visit([&](auto a) -> VarValue {
+        using A = decltype(a);
+        if constexpr (!std::is_arithmetic_v<A>) {
+            throw std::runtime_error("Non-arithmetic return value");
+        }
+        switch (returnType) {
+            case VarType::INT:    return static_cast<int>(a);
+            case VarType::DOUBLE: return static_cast<double>(a);
+            case VarType::CHAR:   return static_cast<char>(a);
+        }
+        throw std::runtime_error("Unknown return type");
+    }, rawRet);
+}
 
-    // 5) Convert each rawArg → declared parameter type:
+} // namespace
+
+VarValue CInterpreterVisitor::callFunction(const std::string &funcName, const Function &func,
+                                           std::span<const VarValue> rawArgs) {
+    checkpoint();
+    BudgetMeter::CallScope callScope(budgetMeter);
+    Profiler::CallScope profileScope(profiler, funcName);
+    const FunctionBody &body = func.compiled();
+    TRACE(VCI_TRACE_DEBUG, TraceEvent::CallEnter,
+          body.tree ? static_cast<int64_t>(body.tree->getStart()->getLine()) : 0,
+          static_cast<int64_t>(rawArgs.size()));
+
+    // 1) Check arity:
+    checkArity(funcName, func, rawArgs.size());
+
+    // 2) Convert each rawArg → declared parameter type. Host functions take
+    // them from the stack, with no scope of their own:
+    if (func.host) {
+        std::array<VarValue, kMaxHostArguments> hostArgs;
+        for (size_t i = 0; i < rawArgs.size(); ++i) {
+            hostArgs[i] = toParameterType(func.parameterTypes[i], rawArgs[i], i);
+        }
+        return func.host(std::span<const VarValue>(hostArgs.data(), rawArgs.size()));
+    }
+    auto &paramNames = func.parameterNames;
+    auto &paramTypes = func.parameterTypes;
     std::vector<VarValue> converted;
     converted.reserve(rawArgs.size());
     for (size_t i = 0; i < rawArgs.size(); ++i) {
-        VarType expected = paramTypes[i];
-        VarValue v = rawArgs[i];
-        VarValue cv = std::visit([&](auto a) -> VarValue {
-            using A = decltype(a);
-            if constexpr (!std::is_arithmetic_v<A>) {
-                throw std::runtime_error("Non-arithmetic argument for parameter " + std::to_string(i));
-            }
-            switch (expected) {
-                case VarType::INT:    return static_cast<int>(a);
-                case VarType::DOUBLE: return static_cast<double>(a);
-                case VarType::CHAR:   return static_cast<char>(a);
-            }
-            throw std::runtime_error("Unknown parameter type");
-        }, v);
-        converted.push_back(cv);
+        converted.push_back(toParameterType(paramTypes[i], rawArgs[i], i));
     }
 
-    // 6) Run the function body in a fresh scope:
-    {
-        EnvScopeGuard guard(env);  // pushes new scope, pops on destructor
+    // 3) Run the function body in a fresh scope:
+    EnvScopeGuard guard(env);  // pushes new scope, pops on destructor
+    ActivationGuard activation(*this, body.unit.get());
 
-        // 6a) Define the parameters:
-        for (size_t i = 0; i < paramNames.size(); ++i) {
-            env->define(paramNames[i], paramTypes[i], converted[i]);
-        }
+    // 3a) Define the parameters:
+    for (size_t i = 0; i < paramNames.size(); ++i) {
+        env->define(paramNames[i], paramTypes[i], converted[i]);
+    }
 
-        // 6b) Re-lex & parse the saved body:
-        antlr4::ANTLRInputStream bodyIn(func->bodyText);
-        CLexer                   bodyLex(&bodyIn);
-        antlr4::CommonTokenStream bodyTokens(&bodyLex);
-        CParser                  bodyParser(&bodyTokens);
-        auto *bodyCtx = bodyParser.compoundStatement();
+    // 3b) Use the body parsed when the function was defined:
+    auto *bodyCtx = body.tree;
+    if (!bodyCtx) {
+        throw std::runtime_error("Function '" + funcName + "' has no body.");
+    }
 
-        // 6c) Execute, catching any ReturnException:
-        try {
-            // if no return, we rely on aggregateResult to give us the last statement’s value
-            VarValue rawRet = std::any_cast<VarValue>(visit(bodyCtx));
-            // convert it to the declared return type:
-            VarValue finalRet = std::visit([&](auto a) -> VarValue {
-                using A = decltype(a);
-                if constexpr (!std::is_arithmetic_v<A>) {
-                    throw std::runtime_error("Non-arithmetic return value");
-                }
-                switch (func->returnType) {
-                    case VarType::INT:    return static_cast<int>(a);
-                    case VarType::DOUBLE: return static_cast<double>(a);
-                    case VarType::CHAR:   return static_cast<char>(a);
-                }
-                throw std::runtime_error("Unknown return type");
-            }, rawRet);
-            return std::any(finalRet);
+    // 3c) Execute, catching any ReturnException:
+    try {
+        // if no return, we rely on aggregateResult to give us the last statement’s value
+        return toReturnType(func.returnType, std::any_cast<VarValue>(visit(bodyCtx)));
+    }
+    catch (const ReturnException &retEx) {
+        return toReturnType(func.returnType, retEx.getValue());
+    }
+}
+
+VarValue CInterpreterVisitor::inlineCall(const std::string &funcName, const Function &func,
+                                         std::span<const VarValue> rawArgs) {
+    checkpoint();
+    BudgetMeter::CallScope callScope(budgetMeter);
+    const FunctionBody &body = func.compiled();
+    TRACE(VCI_TRACE_DEBUG, TraceEvent::CallEnter, static_cast<int64_t>(body.tree->getStart()->getLine()),
+          static_cast<int64_t>(rawArgs.size()));
+    checkArity(funcName, func, rawArgs.size());
+
+    // Parameters and locals share one scope; analyzeInline() made sure their
+    // names are distinct.
+    EnvScopeGuard guard(env);
+    ActivationGuard activation(*this, body.unit.get());
+    ReuseScope repeats(*this);
+    repeats.armBlock(body.tree);
+    ++inlineDepth;
+    struct DepthGuard {
+        unsigned &depth;
+        ~DepthGuard() { --depth; }
+    } depthGuard{inlineDepth};
+
+    for (size_t i = 0; i < rawArgs.size(); ++i) {
+        env->define(func.parameterNames[i], func.parameterTypes[i],
+                    toParameterType(func.parameterTypes[i], rawArgs[i], i));
+    }
+    for (auto *step : body.inlineBody->steps) {
+        visit(step);
+    }
+    // The final return, without throwing.
+    return toReturnType(func.returnType, std::any_cast<VarValue>(visit(body.inlineBody->result)));
+}
+
+// Swapping keeps the caller's cached values (and pointers to them) intact.
+CInterpreterVisitor::ActivationGuard::ActivationGuard(CInterpreterVisitor &visitor, const ParseUnit *calleeUnit)
+    : visitor(visitor),
+      callerPlan(std::exchange(visitor.plan, calleeUnit ? calleeUnit->optimizationPlan() : nullptr)),
+      callerUnitId(std::exchange(visitor.unitId, calleeUnit ? calleeUnit->id() : 0)) {
+    callerValues.swap(visitor.reusable);
+}
+
+CInterpreterVisitor::ActivationGuard::~ActivationGuard() {
+    visitor.plan = callerPlan;
+    visitor.unitId = callerUnitId;
+    visitor.reusable.swap(callerValues);
+}
+
+void CInterpreterVisitor::ReuseScope::armLoop(const antlr4::ParserRuleContext *loop) {
+    if (!visitor.optimizer.hoistLoopInvariants || !visitor.plan) {
+        return;
+    }
+    const LoopPlan *loopPlan = visitor.plan->loop(loop);
+    if (!loopPlan) {
+        return;
+    }
+    std::vector<const antlr4::ParserRuleContext *> invariants;
+    selectInvariants(*loopPlan, *visitor.env, invariants);
+    for (const auto *node : invariants) {
+        if (visitor.reusable.try_emplace(node).second) {
+            armed.push_back(node);
+        }
+    }
+}
+
+void CInterpreterVisitor::ReuseScope::armBlock(const antlr4::ParserRuleContext *block) {
+    if (!visitor.optimizer.eliminateCommonSubexpressions || !visitor.plan) {
+        return;
+    }
+    const BlockPlan *blockPlan = visitor.plan->block(block);
+    if (!blockPlan) {
+        return;
+    }
+    std::vector<const BlockPlan::Repeat *> repeats;
+    selectRepeats(*blockPlan, *visitor.env, repeats);
+    for (const auto *repeat : repeats) {
+        auto [first, armedFirst] = visitor.reusable.try_emplace(repeat->first);
+        if (armedFirst) {
+            armed.push_back(repeat->first);
         }
-        catch (const ReturnException &retEx) {
-            VarValue rawRet = retEx.getValue();  // now returns VarValue directly
-            VarValue finalRet = std::visit([&](auto a) -> VarValue {
-                using A = decltype(a);
-                if constexpr (!std::is_arithmetic_v<A>) {
-                    throw std::runtime_error("Non-arithmetic return value");
-                }
-                switch (func->returnType) {
-                    case VarType::INT:    return static_cast<int>(a);
-                    case VarType::DOUBLE: return static_cast<double>(a);
-                    case VarType::CHAR:   return static_cast<char>(a);
-                }
-                throw std::runtime_error("Unknown return type");
-            }, rawRet);
-            return std::any(finalRet);
+        // Map nodes never move, so the pointer stays valid while both exist.
+        auto [again, armedAgain] = visitor.reusable.try_emplace(repeat->repeat);
+        if (armedAgain) {
+            again->second.same = first->second.same ? first->second.same : &first->second;
+            armed.push_back(repeat->repeat);
         }
     }
+}
 
-    // unreachable: compoundStatement always returns something
-    return std::any();
+CInterpreterVisitor::ReuseScope::~ReuseScope() {
+    for (const auto *node : armed) {
+        visitor.reusable.erase(node);
+    }
 }
@@ -4,8 +4,19 @@
 #pragma once
 
 #include "CBaseVisitor.h"  // Generated by ANTLR from your grammar (C.g4)
+#include "Builtins.h"
 #include "Environment.h"
+#include "ExecutionBudget.h"
+#include "ExecutionControl.h"
+#include "Profiler.h"
+#include "ProgramOutput.h"
+#include "Optimizer.h"
+#include "ParseUnit.h"
+#include <memory>
+#include <optional>
+#include <span>
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include <any>
 
@@ -14,8 +25,29 @@ class CInterpreterVisitor : public CBaseVisitor {
 public:
     CInterpreterVisitor(Environment* env);
     CInterpreterVisitor(Environment* env, antlr4::CommonTokenStream* tokens);
+    // Visits trees owned by `unit`; functions defined here keep the unit alive
+    // and reuse their parsed body instead of re-parsing bodyText per call.
+    CInterpreterVisitor(Environment* env, std::shared_ptr<ParseUnit> unit);
     virtual ~CInterpreterVisitor();
 
+    // Optional; when set, loops and calls stop with EvaluationCancelled once
+    // control->cancelRequested is raised.
+    void setExecutionControl(ExecutionControl* executionControl) { control = executionControl; }
+
+    // Optional; when set, loops and calls are charged to `meter`, which throws
+    // BudgetExceeded once the evaluation's budget runs out.
+    void setBudgetMeter(BudgetMeter* meter) { budgetMeter = meter; }
+
+    // Optional; when set, calls and executed statements are reported to it.
+    void setProfiler(Profiler* activeProfiler) { profiler = activeProfiler; }
+
+    // Defaults to everything on; see OptimizerOptions.
+    void setOptimizerOptions(const OptimizerOptions& options) { optimizer = options; }
+
+    // Where printf, putchar and puts write; without one their output is
+    // discarded.
+    void setOutput(ProgramOutput* programOutput) { output = programOutput; }
+
 
 
     // Helper struct for for-loop components.
@@ -37,11 +69,18 @@ public:
 
     std::any visitPostfixExpression(CParser::PostfixExpressionContext *ctx) override;
 
+    // Calls func with already-evaluated arguments: checks arity, converts the
+    // arguments and result to the declared types and runs the body in a new
+    // scope, or for a host function, its trampoline. Shared by call
+    // expressions and the embedding API (FunctionHandle).
+    VarValue callFunction(const std::string &funcName, const Function &func, std::span<const VarValue> args);
+
     std::any visitUnaryMinusExpression(CParser::UnaryMinusExpressionContext *ctx) override;
     std::any visitVariableReference(CParser::VariableReferenceContext *ctx) override;
     std::any visitDeclareVariable(CParser::DeclareVariableContext *ctx) override;
     std::any visitNumberLiteral(CParser::NumberLiteralContext *ctx) override;
     std::any visitCharLiteral(CParser::CharLiteralContext *ctx) override;
+    std::any visitStringLiteral(CParser::StringLiteralContext *ctx) override;
     std::any aggregateResult(std::any aggregate, std::any nextResult) override;
 
     std::any visitReturnStmt(CParser::ReturnStmtContext *ctx) override;
@@ -70,11 +109,100 @@ public:
 
     std::any visitForDeclaration(CParser::ForDeclarationContext *ctx) override;
     std::any visitCompoundStatement(CParser::CompoundStatementContext *ctx) override;
+    std::any visitReplInput(CParser::ReplInputContext *ctx) override;
+    std::any visitStatement(CParser::StatementContext *ctx) override;
 
 
 private:
+    // Safe point: throws EvaluationCancelled if cancellation was requested,
+    // or BudgetExceeded if the budget ran out.
+    void checkpoint() const {
+        if (control && control->cancelRequested.load(std::memory_order_relaxed)) {
+            throw EvaluationCancelled();
+        }
+        if (budgetMeter) {
+            budgetMeter->step();
+        }
+    }
+
+    // A value being reused (see Optimizer.h): empty until first computed. A
+    // repeated subexpression shares the entry of its first occurrence.
+    struct Reusable {
+        std::optional<VarValue> value;
+        Reusable* same = nullptr;
+    };
+    using ReusableMap = std::unordered_map<const antlr4::ParserRuleContext*, Reusable>;
+
+    // Arms the values one run of a loop or block may reuse, and removes them
+    // when it ends, except for entries an enclosing scope armed first: those
+    // stay valid for longer and may already hold a value.
+    class ReuseScope {
+    public:
+        explicit ReuseScope(CInterpreterVisitor& visitor) : visitor(visitor) {}
+        ~ReuseScope();
+        ReuseScope(const ReuseScope&) = delete;
+        ReuseScope& operator=(const ReuseScope&) = delete;
+
+        void armLoop(const antlr4::ParserRuleContext* loop);
+        void armBlock(const antlr4::ParserRuleContext* block);
+    private:
+        CInterpreterVisitor& visitor;
+        std::vector<const antlr4::ParserRuleContext*> armed;
+    };
+
+    // Gives a call its own plan, unit id and cached values, restoring the
+    // caller's when the call ends.
+    class ActivationGuard {
+    public:
+        ActivationGuard(CInterpreterVisitor& visitor, const ParseUnit* calleeUnit);
+        ~ActivationGuard();
+        ActivationGuard(const ActivationGuard&) = delete;
+        ActivationGuard& operator=(const ActivationGuard&) = delete;
+    private:
+        CInterpreterVisitor& visitor;
+        const OptimizationPlan* callerPlan;
+        uint64_t callerUnitId;
+        ReusableMap callerValues;
+    };
+
+    // Where to keep the value of ctx, if it is armed. Only operations ever
+    // are, and they all have at least two children.
+    std::optional<VarValue>* reuseSlot(const antlr4::ParserRuleContext* ctx) {
+        if (reusable.empty() || ctx->children.size() < 2) {
+            return nullptr;
+        }
+        auto it = reusable.find(ctx);
+        if (it == reusable.end()) {
+            return nullptr;
+        }
+        Reusable& entry = it->second.same ? *it->second.same : it->second;
+        return &entry.value;
+    }
+
+    // Evaluates the arguments of call `ctx` (string literals come decoded from
+    // the plan) and runs `builtin` with them.
+    VarValue invokeBuiltin(Builtin builtin, const std::string &name, CParser::PostfixExpressionContext *ctx);
+
+    // callFunction() for a function with an InlineBody: runs the body in place
+    // (one scope, no ReturnException), with the same checks and conversions.
+    VarValue inlineCall(const std::string &funcName, const Function &func, std::span<const VarValue> args);
+
     Environment* env;
+    ExecutionControl* control = nullptr;
+    BudgetMeter* budgetMeter = nullptr;
+    Profiler* profiler = nullptr;
+    ProgramOutput* output = nullptr;
     antlr4::CommonTokenStream* tokens;
+    std::shared_ptr<ParseUnit> unit;
+
+    // Analyses of the tree being visited: the unit's, or while a function
+    // runs, the one its body came from. Cached values belong to the current
+    // call, so callFunction() and inlineCall() set both aside for the callee.
+    const OptimizationPlan* plan = nullptr;
+    uint64_t unitId = 0; // ParseUnit::id() of that tree, for the profiler
+    OptimizerOptions optimizer;
+    ReusableMap reusable;
+    unsigned inlineDepth = 0; // inlined calls currently running inside one another
 };
 
 
@@ -1,9 +1,8 @@
 #include "CustomErrorListener.h"
 #include <sstream>
 
-CustomErrorListener::CustomErrorListener() {
-    // Constructor (if needed)
-}
+CustomErrorListener::CustomErrorListener(size_t lineOffset)
+    : lineOffset(lineOffset) {}
 
 CustomErrorListener::~CustomErrorListener() {
     // Destructor (if needed)
@@ -16,7 +15,7 @@ void CustomErrorListener::syntaxError(antlr4::Recognizer *recognizer,
                                         const std::string &msg,
                                         std::exception_ptr e) {
     std::ostringstream errorStream;
-    errorStream << "Syntax error at line " << line
+    errorStream << "Syntax error at line " << line + lineOffset
                 << ", column " << charPositionInLine
                 << ": " << msg;
     // Throw a runtime_error with the error message.
@@ -7,7 +7,8 @@
 
 class CustomErrorListener : public antlr4::BaseErrorListener {
 public:
-    CustomErrorListener();
+    // lineOffset is added to every reported line (see ParseUnit).
+    explicit CustomErrorListener(size_t lineOffset = 0);
     virtual ~CustomErrorListener();
 
     // Override the syntaxError method to handle errors.
@@ -17,6 +18,9 @@ public:
                              size_t charPositionInLine,
                              const std::string &msg,
                              std::exception_ptr e) override;
+
+private:
+    size_t lineOffset;
 };
 
 #endif // CUSTOM_ERROR_LISTENER_H
@@ -4,17 +4,50 @@
 
 #include "Environment.h"
 
+#include <atomic>
+
+namespace {
+
+// Returns `table` ready for writing: created if missing, copied if another
+// Environment still shares it.
+template<typename Table>
+Table &writable(std::shared_ptr<Table> &table) {
+    if (!table) {
+        table = std::make_shared<Table>();
+    } else if (table.use_count() > 1) {
+        table = std::make_shared<Table>(*table);
+    } else {
+        // Sole owner now, but a copy on another thread may only just have let
+        // go, and use_count() is a relaxed read: this fence pairs with the
+        // release in that copy's shared_ptr destructor, so its reads of the
+        // table happen before the writes that follow.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *table;
+}
+
+} // namespace
+
 Environment::Environment(Environment *parentEnv)
     : parent(parentEnv) {}
 
+Environment::VariableTable &Environment::writableVariables() {
+    return writable(variables);
+}
+
+Environment::FunctionTable &Environment::writableFunctions() {
+    return writable(functions);
+}
+
 void Environment::define(const std::string &name, VarType type, const std::variant<int, double, char> value) {
-    variables[name] = {type, value};
+    writableVariables()[name] = {type, value};
 }
 
 void Environment::assign(const std::string &name, VarType type, const std::variant<int, double, char>& value) {
     // Check if the variable exists in this scope.
-    if (variables.find(name) != variables.end()) {
-        variables[name] = {type, value};
+    if (variables && variables->find(name) != variables->end()) {
+        // Look up again after a possible copy-on-write.
+        writableVariables().find(name)->second = {type, value};
     } else if (parent != nullptr) {
         // Recurse into the parent environment.
         parent->assign(name, type, value);
@@ -24,17 +57,20 @@ void Environment::assign(const std::string &name, VarType type, const std::varia
 }
 
 Variable Environment::get(const std::string &name) const {
-    auto it = variables.find(name);
-    if (it != variables.end()) {
-        return it->second;
-    } else if (parent != nullptr) {
+    if (variables) {
+        auto it = variables->find(name);
+        if (it != variables->end()) {
+            return it->second;
+        }
+    }
+    if (parent != nullptr) {
         return parent->get(name);
     }
     throw std::runtime_error("Undefined variable: " + name);
 }
 
 bool Environment::exists(const std::string &name) const {
-    if (variables.find(name) != variables.end())
+    if (variables && variables->find(name) != variables->end())
         return true;
     if (parent != nullptr)
         return parent->exists(name);
@@ -53,24 +89,50 @@ Environment* Environment::popScope() {
 }
 
 // Function-related methods
+void Environment::defineFunction(const std::string &name, std::shared_ptr<const Function> func) {
+    writableFunctions()[name] = std::move(func);
+}
 void Environment::defineFunction(const std::string &name, const Function &func) {
-    functions[name] = func;
+    writableFunctions()[name] = std::make_shared<const Function>(func);
 }
-Function* Environment::getFunction(const std::string &name) {
-    auto it = functions.find(name);
-    if (it != functions.end()) {
-        return &it->second;
-    } else if (parent != nullptr) {
+const Function* Environment::getFunction(const std::string &name) const {
+    if (functions) {
+        auto it = functions->find(name);
+        if (it != functions->end()) {
+            return it->second.get();
+        }
+    }
+    if (parent != nullptr) {
         return parent->getFunction(name);
     }
     return nullptr;
 }
+std::shared_ptr<const Function> Environment::getFunctionShared(const std::string &name) const {
+    if (functions) {
+        auto it = functions->find(name);
+        if (it != functions->end()) {
+            return it->second;
+        }
+    }
+    if (parent != nullptr) {
+        return parent->getFunctionShared(name);
+    }
+    return nullptr;
+}
 bool Environment::functionExists(const std::string &name) const {
-    if (functions.find(name) != functions.end()) {
+    if (functions && functions->find(name) != functions->end()) {
         return true;
     }
     if (parent != nullptr) {
         return parent->functionExists(name);
     }
     return false;
-}
\ No newline at end of file
+}
+
+bool Environment::sharesVariablesWith(const Environment &other) const {
+    return variables && variables == other.variables;
+}
+
+bool Environment::sharesFunctionsWith(const Environment &other) const {
+    return functions && functions == other.functions;
+}
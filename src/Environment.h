@@ -1,6 +1,7 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <stdexcept>
@@ -8,11 +9,20 @@
 #include "Variable.h"
 #include "Function.h"
 
+// A scope's variables and functions. Copying an Environment is O(1): the copy
+// shares the variable and function tables with the original, and whichever
+// side first writes to a shared table takes its own copy of it (variables and
+// functions separately, so a fork that only assigns variables keeps sharing
+// its function definitions). Copies may be used on different threads.
 class Environment {
 public:
     // Constructor. Optionally provide a parent for nested scopes.
     Environment(Environment* parentEnv = nullptr);
 
+    // A fork of `other`, with the same parent.
+    Environment(const Environment &other) = default;
+    Environment &operator=(const Environment &other) = default;
+
     // Set a variable in the current scope.
     void define(const std::string &name, VarType type, const std::variant<int, double, char> value);
 
@@ -29,13 +39,30 @@ public:
     // popScope returns the parent environment (exiting the current scope).
     Environment* popScope();
 
+    // Functions are immutable once defined, so environments of different
+    // interpreters (possibly on different threads) can share them.
+    void defineFunction(const std::string &name, std::shared_ptr<const Function> func);
     void defineFunction(const std::string &name, const Function &func);
-    Function* getFunction(const std::string &name);
+    const Function* getFunction(const std::string &name) const;
+    std::shared_ptr<const Function> getFunctionShared(const std::string &name) const;
     bool functionExists(const std::string &name) const;
 
+    // Whether this scope's tables are still shared with another copy (for
+    // tests and diagnostics).
+    bool sharesVariablesWith(const Environment &other) const;
+    bool sharesFunctionsWith(const Environment &other) const;
+
 private:
-    std::unordered_map<std::string, Variable> variables;
-    std::unordered_map<std::string, Function> functions;
+    using VariableTable = std::unordered_map<std::string, Variable>;
+    using FunctionTable = std::unordered_map<std::string, std::shared_ptr<const Function>>;
+
+    // Tables are created on first write (most block scopes define nothing)
+    // and copied on write while shared.
+    VariableTable &writableVariables();
+    FunctionTable &writableFunctions();
+
+    std::shared_ptr<VariableTable> variables;
+    std::shared_ptr<FunctionTable> functions;
     //TODO considering upgrading to a smart pointer
     Environment* parent;  // Parent scope (nullptr for global scope).
 };
@@ -0,0 +1,90 @@
+// EvaluationWorker.cpp
+#include "EvaluationWorker.h"
+
+#include <chrono>
+#include <exception>
+
+namespace {
+
+long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+EvaluationWorker::EvaluationWorker()
+    : thread([this] { loop(); }) {}
+
+EvaluationWorker::~EvaluationWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cancel();
+    wake.notify_one();
+    thread.join();
+}
+
+bool EvaluationWorker::submit(Target target, Job job) {
+    if (running.exchange(true, std::memory_order_acq_rel)) {
+        return false;
+    }
+    executionControl.cancelRequested.store(false, std::memory_order_relaxed);
+    startedAtNs.store(nowNs(), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.emplace(target, std::move(job));
+    }
+    wake.notify_one();
+    return true;
+}
+
+void EvaluationWorker::cancel() {
+    executionControl.cancelRequested.store(true, std::memory_order_relaxed);
+}
+
+double EvaluationWorker::elapsedSeconds() const {
+    if (!busy()) {
+        return 0.0;
+    }
+    return static_cast<double>(nowNs() - startedAtNs.load(std::memory_order_relaxed)) / 1e9;
+}
+
+void EvaluationWorker::loop() {
+    for (;;) {
+        std::pair<Target, Job> work;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending.has_value(); });
+            if (stopping) {
+                return;
+            }
+            work = std::move(*pending);
+            pending.reset();
+        }
+
+        Result result;
+        result.target = work.first;
+        try {
+            result.text = work.second();
+        } catch (const std::exception &e) {
+            result.text = std::string("Error: ") + e.what();
+        }
+        result.seconds = elapsedSeconds();
+
+        // Only one job is in flight at a time, so the queue has room unless
+        // the render thread stopped polling; wait for it rather than drop.
+        while (!results.push(std::move(result))) {
+            std::this_thread::yield();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+        }
+        running.store(false, std::memory_order_release);
+        if (resultListener) {
+            resultListener();
+        }
+    }
+}
@@ -0,0 +1,79 @@
+// EvaluationWorker.h
+#ifndef EVALUATION_WORKER_H
+#define EVALUATION_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "ExecutionControl.h"
+#include "SpscQueue.h"
+
+// Runs evaluations for a UI on a background thread, one at a time, so the
+// render loop never blocks on interpreted code. Results come back through a
+// lock-free queue that the render thread polls once per frame; a running job
+// can be cancelled via control(), which the job's interpreters must use.
+class EvaluationWorker {
+public:
+    enum class Target { Repl, File };
+
+    struct Result {
+        Target target = Target::Repl;
+        std::string text;
+        double seconds = 0.0;
+    };
+
+    // Returns the text to show; exceptions are reported as "Error: ...".
+    using Job = std::function<std::string()>;
+
+    EvaluationWorker();
+    ~EvaluationWorker(); // cancels a running job and joins the thread
+
+    EvaluationWorker(const EvaluationWorker &) = delete;
+    EvaluationWorker &operator=(const EvaluationWorker &) = delete;
+
+    // Starts job on the worker thread. Returns false if one is still running.
+    bool submit(Target target, Job job);
+
+    // Asks the running job to stop at its next safe point.
+    void cancel();
+
+    bool busy() const { return running.load(std::memory_order_acquire); }
+
+    // Time since the running job was submitted.
+    double elapsedSeconds() const;
+
+    // Render thread: the next finished job's result, if any.
+    std::optional<Result> poll() { return results.pop(); }
+
+    ExecutionControl &control() { return executionControl; }
+
+    // Called on the worker thread after each result is queued, e.g. to wake a
+    // render loop that is blocked waiting for events. Set it before the first
+    // submit().
+    void setResultListener(std::function<void()> listener) { resultListener = std::move(listener); }
+
+private:
+    void loop();
+
+    ExecutionControl executionControl;
+    SpscQueue<Result, 16> results;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::optional<std::pair<Target, Job>> pending;
+    bool stopping = false;
+
+    std::function<void()> resultListener;
+
+    std::atomic<bool> running{false};
+    std::atomic<long long> startedAtNs{0};
+
+    std::thread thread; // last, so it starts after everything it uses exists
+};
+
+#endif // EVALUATION_WORKER_H
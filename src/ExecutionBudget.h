@@ -0,0 +1,93 @@
+// ExecutionBudget.h
+#ifndef EXECUTION_BUDGET_H
+#define EXECUTION_BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// Hard limits for one evaluation of untrusted code. Zero means unlimited.
+struct ExecutionBudget {
+    uint64_t maxSteps = 0;                 // loop iterations plus function calls
+    unsigned maxCallDepth = 0;             // nested interpreted calls
+    std::chrono::milliseconds timeout{0};  // wall clock, from the start of the evaluation
+};
+
+// Thrown when an evaluation runs out of budget. Distinct from other runtime
+// errors so hosts can tell "script misbehaved" from "script was wrong".
+class BudgetExceeded : public std::runtime_error {
+public:
+    enum class Limit { Steps, CallDepth, Time };
+
+    BudgetExceeded(Limit limit, const std::string &message)
+        : std::runtime_error(message), exceeded(limit) {}
+
+    Limit limit() const { return exceeded; }
+
+private:
+    Limit exceeded;
+};
+
+// Tracks one evaluation against its budget. The visitor calls step() at every
+// loop back-edge and function entry, and holds a CallScope for each call. A
+// step costs an increment and two compares; the clock is only read every
+// kClockInterval steps.
+class BudgetMeter {
+public:
+    static constexpr uint64_t kClockInterval = 1024;
+
+    explicit BudgetMeter(const ExecutionBudget &budget)
+        : stepLimit(budget.maxSteps ? budget.maxSteps : std::numeric_limits<uint64_t>::max()),
+          depthLimit(budget.maxCallDepth ? budget.maxCallDepth : std::numeric_limits<unsigned>::max()),
+          nextClockCheck(budget.timeout.count() > 0 ? kClockInterval : std::numeric_limits<uint64_t>::max()),
+          deadline(std::chrono::steady_clock::now() + budget.timeout) {}
+
+    void step() {
+        if (++steps > stepLimit) {
+            throw BudgetExceeded(BudgetExceeded::Limit::Steps,
+                                 "Step budget of " + std::to_string(stepLimit) + " exceeded");
+        }
+        if (steps >= nextClockCheck) {
+            nextClockCheck += kClockInterval;
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw BudgetExceeded(BudgetExceeded::Limit::Time, "Time budget exceeded");
+            }
+        }
+    }
+
+    // Counts one level of call depth for its lifetime. A null meter is a no-op.
+    class CallScope {
+    public:
+        explicit CallScope(BudgetMeter *meter) : meter(meter) {
+            if (meter && ++meter->depth > meter->depthLimit) {
+                --meter->depth;
+                throw BudgetExceeded(BudgetExceeded::Limit::CallDepth,
+                                     "Call depth limit of " + std::to_string(meter->depthLimit) + " exceeded");
+            }
+        }
+        ~CallScope() {
+            if (meter) {
+                --meter->depth;
+            }
+        }
+        CallScope(const CallScope &) = delete;
+        CallScope &operator=(const CallScope &) = delete;
+
+    private:
+        BudgetMeter *meter;
+    };
+
+    uint64_t stepsUsed() const { return steps; }
+
+private:
+    uint64_t steps = 0;
+    uint64_t stepLimit;
+    unsigned depth = 0;
+    unsigned depthLimit;
+    uint64_t nextClockCheck;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+#endif // EXECUTION_BUDGET_H
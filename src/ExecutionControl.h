@@ -0,0 +1,24 @@
+// ExecutionControl.h
+#ifndef EXECUTION_CONTROL_H
+#define EXECUTION_CONTROL_H
+
+#include <atomic>
+#include <stdexcept>
+
+// Shared between a running evaluation and whoever supervises it (e.g. the UI
+// thread). The visitor polls it at safe points: every loop back-edge and
+// every function entry (before the loop body or function body runs).
+struct ExecutionControl {
+    // Set from any thread to stop the evaluation at its next safe point.
+    // The supervisor clears it before starting the next evaluation.
+    std::atomic<bool> cancelRequested{false};
+};
+
+// Thrown at a safe point once cancellation was requested. Scopes unwind as
+// for any other runtime error, and the interpreter stays usable afterwards.
+class EvaluationCancelled : public std::runtime_error {
+public:
+    EvaluationCancelled() : std::runtime_error("Evaluation cancelled") {}
+};
+
+#endif // EXECUTION_CONTROL_H
@@ -0,0 +1,64 @@
+// FramePacer.h
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <algorithm>
+
+// Decides when the GUI loop draws. An idle UI draws nothing and blocks on
+// events; input, arriving output and window changes each buy a few frames
+// (ImGui needs a couple to settle hover and layout), and while an evaluation
+// runs the loop wakes at kBusyRefreshHz to update its elapsed-time display.
+// No frame is ever drawn sooner than 1/maxFps after the previous one.
+//
+// Times are seconds on any monotonic clock (the UI uses glfwGetTime()).
+class FramePacer {
+public:
+    static constexpr int kSettleFrames = 3;
+    static constexpr double kBusyRefreshHz = 10.0;
+    static constexpr double kDefaultMaxFps = 60.0;
+
+    explicit FramePacer(double maxFps = kDefaultMaxFps) { setMaxFps(maxFps); }
+
+    // 0 (or less) removes the cap.
+    void setMaxFps(double fps) { cap = fps > 0.0 ? fps : 0.0; }
+    double maxFps() const { return cap; }
+
+    // Something on screen may have changed.
+    void noteActivity() { owedFrames = kSettleFrames; }
+
+    // How long the loop may block waiting for events before drawing the next
+    // frame: 0 to draw now, or a negative value to wait indefinitely.
+    double waitSeconds(bool busy, double now) const {
+        if (owedFrames > 0) {
+            return throttleSeconds(now);
+        }
+        if (busy) {
+            return std::max(throttleSeconds(now), lastFrame + 1.0 / kBusyRefreshHz - now);
+        }
+        return -1.0;
+    }
+
+    // Time left before the cap allows another frame (0 if it already does).
+    double throttleSeconds(double now) const {
+        if (cap == 0.0 || !anyFrame) {
+            return 0.0;
+        }
+        return std::max(0.0, lastFrame + 1.0 / cap - now);
+    }
+
+    void frameDrawn(double now) {
+        lastFrame = now;
+        anyFrame = true;
+        if (owedFrames > 0) {
+            --owedFrames;
+        }
+    }
+
+private:
+    double cap = 0.0;
+    double lastFrame = 0.0;
+    bool anyFrame = false;
+    int owedFrames = kSettleFrames; // draw the first frames unconditionally
+};
+
+#endif // FRAME_PACER_H
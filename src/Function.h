@@ -2,9 +2,52 @@
 #ifndef FUNCTION_H
 #define FUNCTION_H
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 #include "antlr4-runtime.h"
+#include "CParser.h"
+#include "Variable.h"
+
+class ParseUnit;
+
+// The globals a function body reads and assigns (names it uses without
+// declaring them) and the functions it calls. Filled in by compileFunction()
+// for the optimizer (see Optimizer.h); each list is sorted.
+struct FunctionEffects {
+    std::vector<std::string> globalReads;
+    std::vector<std::string> globalWrites;
+    std::vector<std::string> callees;
+};
+
+// A body small and simple enough to run in place of a call: declarations and
+// expression statements, then `return result;`. Filled in by compileFunction()
+// when the body qualifies (see analyzeInline() in Optimizer.h).
+struct InlineBody {
+    std::vector<antlr4::ParserRuleContext *> steps;
+    CParser::ExpressionContext *result = nullptr;
+};
+
+// Most arguments a host function can take (see HostFunction.h).
+constexpr size_t kMaxHostArguments = 8;
+
+// The trampoline of a function implemented in C++ by the host. It is called
+// with exactly one argument per parameter, each already converted to its
+// parameter's type, and returns a value of the return type.
+using HostCall = std::function<VarValue(std::span<const VarValue>)>;
+
+// A function's parsed body and what the optimizer learned from it.
+struct FunctionBody {
+    CParser::CompoundStatementContext *tree = nullptr; // kept alive by `unit`
+    std::shared_ptr<ParseUnit> unit;
+    FunctionEffects effects;
+    std::optional<InlineBody> inlineBody;
+};
 
 // A simple structure to represent a function.
 struct Function {
@@ -12,6 +55,27 @@ struct Function {
     std::vector<VarType> parameterTypes;          // parallel to
     std::vector<std::string> parameterNames;      // parameterNames
     std::string bodyText;
+
+    // Set instead of a body for host functions.
+    HostCall host;
+
+    // The parsed body. Read it through compiled(): a function known only by
+    // its bodyText (loaded from the program cache) is parsed and analysed on
+    // first use, so a cache hit parses just the functions that are needed.
+    const FunctionBody &compiled() const;
+
+    // Filled in before compileFunction(): the tree for a function defined from
+    // one (compileFunction() adds the analyses), the effects for a host
+    // function.
+    FunctionBody parsed;
+
+    // Set by compileFunction() instead when there is no tree; the first
+    // compiled() fills it in. Shared by copies, so each body is parsed once.
+    struct DeferredBody {
+        std::once_flag once;
+        FunctionBody body;
+    };
+    std::shared_ptr<DeferredBody> deferred;
 };
 
 
@@ -0,0 +1,59 @@
+#ifndef FUNCTION_HANDLE_H
+#define FUNCTION_HANDLE_H
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "CInterpreterVisitor.h"
+#include "Environment.h"
+#include "Function.h"
+#include "Variable.h"
+
+template<typename Signature>
+class FunctionHandle;
+
+// A typed, callable reference to an interpreted function, obtained from
+// Interpreter::function<R(Args...)>(name). The signature is checked once, at
+// lookup; calls pass native values straight to the function body, with no
+// parsing or string conversion. A handle keeps its function alive across
+// redefinitions, runs in its interpreter's global environment and must not
+// outlive that interpreter (nor be used from two threads at once).
+template<typename R, typename... Args>
+class FunctionHandle<R(Args...)> {
+public:
+    FunctionHandle(Environment *env, ExecutionControl *control, ProgramOutput *output, std::string name,
+                   std::shared_ptr<const Function> func)
+        : env(env), control(control), output(output), name(std::move(name)), func(std::move(func)) {
+        if (!this->func) {
+            throw std::runtime_error("Function '" + this->name + "' is not defined.");
+        }
+        constexpr std::array<VarType, sizeof...(Args)> expected{nativeVarType<Args>()...};
+        bool matches = this->func->returnType == nativeVarType<R>() &&
+                       this->func->parameterTypes.size() == expected.size();
+        for (size_t i = 0; matches && i < expected.size(); ++i) {
+            matches = this->func->parameterTypes[i] == expected[i];
+        }
+        if (!matches) {
+            throw std::runtime_error("Function '" + this->name + "' does not match the requested signature.");
+        }
+    }
+
+    R operator()(Args... args) const {
+        std::array<VarValue, sizeof...(Args)> values{VarValue(args)...};
+        CInterpreterVisitor visitor(env);
+        visitor.setExecutionControl(control);
+        visitor.setOutput(output);
+        return std::get<R>(visitor.callFunction(name, *func, values));
+    }
+
+private:
+    Environment *env;
+    ExecutionControl *control;
+    ProgramOutput *output;
+    std::string name;
+    std::shared_ptr<const Function> func;
+};
+
+#endif // FUNCTION_HANDLE_H
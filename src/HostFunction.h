@@ -0,0 +1,48 @@
+#ifndef HOST_FUNCTION_H
+#define HOST_FUNCTION_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "Function.h"
+#include "Optimizer.h"
+#include "Variable.h"
+
+template<typename Signature>
+struct HostFunction;
+
+// Builds the Function for a C++ callable with signature R(Args...), for
+// Interpreter::defineFunction(). The signature is checked at compile time.
+// callFunction() converts each argument to its parameter type first, as for
+// any function, so the generated trampoline takes it straight out of its
+// VarValue without checking the alternative again.
+template<typename R, typename... Args>
+struct HostFunction<R(Args...)> {
+    static_assert(sizeof...(Args) <= kMaxHostArguments, "Too many parameters for a host function");
+
+    template<typename F>
+    static std::shared_ptr<const Function> make(F &&callable) {
+        using Callable = std::decay_t<F>;
+        static_assert(std::is_invocable_r_v<R, Callable &, Args...>,
+                      "The callable cannot be called with this signature");
+
+        Function func;
+        func.returnType = nativeVarType<R>();
+        func.parameterTypes = {nativeVarType<Args>()...};
+        for (size_t i = 0; i < sizeof...(Args); ++i) {
+            func.parameterNames.push_back("arg" + std::to_string(i + 1));
+        }
+        func.parsed.effects = hostFunctionEffects();
+        func.host = [f = Callable(std::forward<F>(callable))](std::span<const VarValue> args) mutable {
+            return [&]<size_t... I>(std::index_sequence<I...>) {
+                return VarValue(static_cast<R>(std::invoke(f, *std::get_if<Args>(&args[I])...)));
+            }(std::index_sequence_for<Args...>{});
+        };
+        return std::make_shared<const Function>(std::move(func));
+    }
+};
+
+#endif // HOST_FUNCTION_H
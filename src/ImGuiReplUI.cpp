@@ -4,16 +4,61 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <thread>
 
+#include "MappedFile.h"
 #include "Utils.h"
 
-ImGuiReplUI::ImGuiReplUI() {
-    replOutput = "";
-    replInput[0] = '\0';
-    fileOutput = "";
-    fileCodeBuffer[0] = '\0';
+namespace {
+
+// Lets ImGui edit a std::string in place: whenever the text changes length,
+// ImGui asks for the string to be resized and continues in its new storage.
+int resizeStringCallback(ImGuiInputTextCallbackData *data) {
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        auto *text = static_cast<std::string *>(data->UserData);
+        text->resize(static_cast<size_t>(data->BufTextLen));
+        data->Buf = text->data();
+    }
+    return 0;
+}
+
+bool inputString(const char *label, std::string &text, ImGuiInputTextFlags flags = 0) {
+    return ImGui::InputText(label, text.data(), text.capacity() + 1, flags | ImGuiInputTextFlags_CallbackResize,
+                            resizeStringCallback, &text);
+}
+
+bool inputStringMultiline(const char *label, std::string &text, const ImVec2 &size) {
+    return ImGui::InputTextMultiline(label, text.data(), text.capacity() + 1, size,
+                                     ImGuiInputTextFlags_CallbackResize, resizeStringCallback, &text);
+}
+
+// Every window event means the UI may need redrawing. These are installed
+// before the ImGui backend, which chains to them from its own callbacks.
+void noteActivity(GLFWwindow *window) {
+    static_cast<FramePacer *>(glfwGetWindowUserPointer(window))->noteActivity();
+}
+
+void installActivityCallbacks(GLFWwindow *window, FramePacer *pacer) {
+    glfwSetWindowUserPointer(window, pacer);
+    glfwSetKeyCallback(window, [](GLFWwindow *w, int, int, int, int) { noteActivity(w); });
+    glfwSetCharCallback(window, [](GLFWwindow *w, unsigned int) { noteActivity(w); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow *w, int, int, int) { noteActivity(w); });
+    glfwSetCursorPosCallback(window, [](GLFWwindow *w, double, double) { noteActivity(w); });
+    glfwSetCursorEnterCallback(window, [](GLFWwindow *w, int) { noteActivity(w); });
+    glfwSetScrollCallback(window, [](GLFWwindow *w, double, double) { noteActivity(w); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow *w, int) { noteActivity(w); });
+    glfwSetWindowSizeCallback(window, [](GLFWwindow *w, int, int) { noteActivity(w); });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow *w) { noteActivity(w); });
+}
+
+} // namespace
+
+ImGuiReplUI::ImGuiReplUI(double maxFps) : pacer(maxFps) {
+    repl.setExecutionControl(&worker.control());
 }
 
 ImGuiReplUI::~ImGuiReplUI() {
@@ -36,6 +81,42 @@ void ImGuiReplUI::cleanup() {
     glfwTerminate();
 }
 
+void ImGuiReplUI::openFile() {
+    try {
+        // The mapping goes away after this call; the editor needs its own
+        // writable copy anyway. Nothing else copies the text: the parser
+        // reads the editor buffer in place.
+        MappedFile file(filePath);
+        fileCode.assign(file.view());
+        fileProgram.update(fileCode);
+    } catch (const std::exception &e) {
+        fileOutput.append(std::string("Error: ") + e.what() + "\n");
+    }
+}
+
+void ImGuiReplUI::drawOutputLog(const OutputLog &log) {
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(log.lineCount()));
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+            std::string_view line = log.line(static_cast<size_t>(i));
+            ImGui::TextUnformatted(line.data(), line.data() + line.size());
+        }
+    }
+    clipper.End();
+}
+
+void ImGuiReplUI::drawWorkerStatus() {
+    if (!worker.busy()) {
+        return;
+    }
+    ImGui::Text("Running... %.1f s", worker.elapsedSeconds());
+    ImGui::SameLine();
+    if (ImGui::Button("Cancel")) {
+        worker.cancel();
+    }
+}
+
 void ImGuiReplUI::run() {
     if (!init()) {
         return;
@@ -51,23 +132,50 @@ void ImGuiReplUI::run() {
     }
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1); // vsync
+    installActivityCallbacks(window, &pacer);
+    // A finished evaluation wakes the loop (glfwPostEmptyEvent is safe to
+    // call from any thread).
+    worker.setResultListener([] { glfwPostEmptyEvent(); });
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO &io = ImGui::GetIO();
-    (void) io;
+    // A blinking cursor would need a redraw every blink.
+    io.ConfigInputTextCursorBlink = false;
     ImGui::StyleColorsDark();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 150");
 
-    // Main loop
+    // Main loop. Frames are only drawn when something may have changed (see
+    // FramePacer); otherwise the thread sleeps in glfwWaitEvents.
     static bool firstFrame = true;
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        double wait = pacer.waitSeconds(worker.busy(), glfwGetTime());
+        if (wait < 0.0) {
+            glfwWaitEvents();
+        } else if (wait > 0.0) {
+            glfwWaitEventsTimeout(wait);
+        } else {
+            glfwPollEvents();
+        }
+        // An event may have ended the wait early; still respect the cap.
+        if (double hold = pacer.throttleSeconds(glfwGetTime()); hold > 0.0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(hold));
+            glfwPollEvents();
+        }
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Collect whatever the worker finished since the last frame.
+        while (auto done = worker.poll()) {
+            OutputLog &output = done->target == EvaluationWorker::Target::Repl ? replOutput : fileOutput;
+            output.append(done->text);
+            output.append("\n");
+            pacer.noteActivity();
+        }
+
         // Force the REPL window to get focus on the first frame.
         if (firstFrame)
             ImGui::SetNextWindowFocus();
@@ -75,13 +183,16 @@ void ImGuiReplUI::run() {
         // Build REPL Terminal window
         ImGui::Begin("REPL Terminal");
         ImGui::BeginChild("ScrollingRegion", ImVec2(0, -50), true, ImGuiWindowFlags_HorizontalScrollbar);
-        ImGui::TextUnformatted(replOutput.c_str());
+        drawOutputLog(replOutput);
         if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
             ImGui::SetScrollHereY(1.0f);
         ImGui::EndChild();
 
-        bool inputSubmitted = ImGui::InputText("Input", replInput, IM_ARRAYSIZE(replInput),
-                                               ImGuiInputTextFlags_EnterReturnsTrue);
+        // Commands run one at a time; input is disabled while one is running.
+        ImGui::BeginDisabled(worker.busy());
+        bool inputSubmitted = inputString("Input", replInput, ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::EndDisabled();
+        drawWorkerStatus();
 
         // On the very first frame, immediately set keyboard focus on the input widget.
 
@@ -91,14 +202,15 @@ void ImGuiReplUI::run() {
         }
 
         if (inputSubmitted) {
-            std::string inputStr(replInput);
+            std::string inputStr = replInput;
             if (inputStr == "exit" || inputStr == "quit") {
                 glfwSetWindowShouldClose(window, true);
             } else {
-                std::string result = repl.evaluateCommand(inputStr);
-                replOutput += "> " + inputStr + "\n" + result + "\n";
+                replOutput.append("> " + inputStr + "\n");
+                worker.submit(EvaluationWorker::Target::Repl,
+                              [this, inputStr] { return repl.evaluateCommand(inputStr); });
             }
-            replInput[0] = '\0';
+            replInput.clear();
             // Optionally, refocus the input for subsequent frames:
             ImGui::SetKeyboardFocusHere(-1);
         }
@@ -107,18 +219,57 @@ void ImGuiReplUI::run() {
         // Begin File Execution Window
         ImGui::Begin("File Execution");
 
+        // Load a file from disk into the editor.
+        bool openSubmitted = inputString("Path", filePath, ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::SameLine();
+        if (ImGui::Button("Open") || openSubmitted) {
+            openFile();
+        }
+
         // Source Code Editor: A large multiline text box.
-        ImGui::InputTextMultiline("Source Code", fileCodeBuffer, IM_ARRAYSIZE(fileCodeBuffer),
-                                  ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 16));
-
-        // Run Button: When pressed, evaluate the code from the editor.
-        if (ImGui::Button("Run File")) {
-            std::string code(fileCodeBuffer);
-            // Create a new interpreter instance for file execution.
-            Interpreter fileInterpreter;
-            std::any result = fileInterpreter.evaluate(code, true);
-            std::string resultStr = anyToString(result);
-            fileOutput += "File Result:\n" + resultStr + "\n";
+        // On edit, only the top-level declarations that changed are reparsed.
+        if (inputStringMultiline("Source Code", fileCode, ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 16))) {
+            fileProgram.update(fileCode);
+        }
+
+        // Syntax errors are reported as you type.
+        for (const std::string &error : fileProgram.errors()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+        }
+
+        // Run Button: When pressed, run the already-parsed program on the worker.
+        ImGui::BeginDisabled(worker.busy());
+        bool runPressed = ImGui::Button("Run File");
+        ImGui::EndDisabled();
+        drawWorkerStatus();
+        if (runPressed) {
+            if (fileProgram.hasErrors()) {
+                fileOutput.append("File Result:\nError: fix the syntax errors above first\n");
+            } else {
+                fileOutput.append("File Result:\n");
+                // The job gets its own copy of the unit list; the editor may
+                // reparse while it runs, but units are never modified.
+                worker.submit(EvaluationWorker::Target::File,
+                              [units = fileProgram.units(), control = &worker.control()] {
+                                  // Create a new interpreter instance for file execution.
+                                  Interpreter fileInterpreter;
+                                  fileInterpreter.setExecutionControl(control);
+                                  std::string text;
+                                  auto takeOutput = [&] {
+                                      fileInterpreter.output().drain([&](std::string_view printed) { text += printed; });
+                                  };
+                                  try {
+                                      std::any result = fileInterpreter.runProgram(units);
+                                      takeOutput();
+                                      appendAnyString(text, result);
+                                  } catch (const std::exception &e) {
+                                      takeOutput();
+                                      text += "Error: ";
+                                      text += e.what();
+                                  }
+                                  return text;
+                              });
+            }
         }
 
 
@@ -127,7 +278,7 @@ void ImGuiReplUI::run() {
 
         // File Output: Display results from running file code.
         ImGui::BeginChild("FileOutput", ImVec2(0, 200), true);
-        ImGui::TextUnformatted(fileOutput.c_str());
+        drawOutputLog(fileOutput);
         ImGui::EndChild();
 
         ImGui::End(); // End File Execution Window
@@ -139,6 +290,7 @@ void ImGuiReplUI::run() {
         glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
+        pacer.frameDrawn(glfwGetTime());
     }
 
     // Cleanup
@@ -2,26 +2,52 @@
 #pragma once
 #include "IReplUI.h"
 #include "REPL.h"  // for evaluation logic (or you can use a dedicated method)
+#include "IncrementalProgram.h"
+#include "EvaluationWorker.h"
+#include "FramePacer.h"
+#include "OutputLog.h"
 #include <string>
 
 class ImGuiReplUI : public IReplUI {
 public:
-    ImGuiReplUI();
+    // maxFps caps the frame rate while the UI is active (0 = uncapped).
+    explicit ImGuiReplUI(double maxFps = FramePacer::kDefaultMaxFps);
     ~ImGuiReplUI();
     void run() override;
 
 private:
     // Internal state for the REPL window.
-    std::string replOutput;
-    char replInput[512];
+    OutputLog replOutput;
+    std::string replInput;
 
-    // State for the file execution window.
-    char fileCodeBuffer[1024 * 16];
-    std::string fileOutput;
+    // State for the file execution window. The editor text grows as needed
+    // (see inputString in ImGuiReplUI.cpp).
+    std::string fileCode;
+    std::string filePath;
+    OutputLog fileOutput;
+    // Parsed form of fileCode, updated on every edit.
+    IncrementalProgram fileProgram;
 
     // Instance of your REPL for evaluation
     REPL repl;
 
+    // Decides when the render loop draws a frame.
+    FramePacer pacer;
+
+    // Runs REPL commands and file runs off the render thread. Declared after
+    // repl so it is stopped before repl is destroyed.
+    EvaluationWorker worker;
+
+    // Draws only the lines of `log` that are visible in the current child
+    // window, so the cost doesn't grow with the length of the session.
+    static void drawOutputLog(const OutputLog &log);
+
+    // Replaces the editor contents with the file at filePath.
+    void openFile();
+
+    // Shows the running job's elapsed time and a Cancel button.
+    void drawWorkerStatus();
+
     // Initialization & cleanup helper methods.
     bool init();
     void cleanup();
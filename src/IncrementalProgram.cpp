@@ -0,0 +1,162 @@
+#include "IncrementalProgram.h"
+
+#include <cctype>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+struct Span {
+    size_t start;
+    size_t end;         // one past the last character
+    size_t lineOffset;  // newlines before start
+};
+
+// Splits source into top-level declarations: a declaration ends at a ';' or a
+// closing '}' at brace depth 0. Comments, char and string literals are skipped
+// so that braces inside them don't count. Leading whitespace is not part of a
+// chunk, so reformatting the gaps between functions doesn't force a reparse.
+std::vector<Span> splitTopLevel(std::string_view src) {
+    std::vector<Span> spans;
+    size_t i = 0, line = 0;
+    size_t start = 0, startLine = 0;
+    bool inChunk = false;   // seen code (not just comments) since the last chunk
+    bool started = false;   // chunk start position recorded
+    int depth = 0;
+
+    auto begin = [&](size_t pos) {
+        if (!started) {
+            start = pos;
+            startLine = line;
+            started = true;
+        }
+    };
+    auto finish = [&](size_t end) {
+        spans.push_back({start, end, startLine});
+        inChunk = started = false;
+        depth = 0;
+    };
+
+    while (i < src.size()) {
+        char c = src[i];
+        if (c == '\n') {
+            ++line;
+            ++i;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (src.compare(i, 2, "//") == 0) {
+            begin(i);
+            while (i < src.size() && src[i] != '\n') ++i;
+        } else if (src.compare(i, 2, "/*") == 0) {
+            begin(i);
+            size_t close = src.find("*/", i + 2);
+            size_t stop = close == std::string_view::npos ? src.size() : close + 2;
+            for (; i < stop; ++i) {
+                if (src[i] == '\n') ++line;
+            }
+        } else {
+            begin(i);
+            inChunk = true;
+            if (c == '\'' && i + 2 < src.size() && src[i + 2] == '\'') {
+                i += 3;
+                continue;
+            }
+            if (c == '"') {
+                // To the closing quote, past escapes; a string can't span
+                // lines, so an unterminated one ends at the newline.
+                for (++i; i < src.size() && src[i] != '"' && src[i] != '\n'; ++i) {
+                    if (src[i] == '\\' && i + 1 < src.size() && src[i + 1] != '\n') ++i;
+                }
+                if (i < src.size() && src[i] == '"') ++i;
+                continue;
+            }
+            ++i;
+            if (c == '{') {
+                ++depth;
+            } else if (c == '}') {
+                if (--depth <= 0) finish(i);
+            } else if (c == ';' && depth == 0) {
+                finish(i);
+            }
+        }
+    }
+    // Whatever is left is an unterminated declaration; keep it so the parser
+    // reports it. Trailing comments on their own are dropped.
+    if (inChunk) {
+        spans.push_back({start, src.size(), startLine});
+    }
+    return spans;
+}
+
+} // namespace
+
+IncrementalProgram::Chunk IncrementalProgram::parseChunk(std::string text, size_t lineOffset) {
+    Chunk chunk;
+    chunk.text = std::move(text);
+    chunk.lineOffset = lineOffset;
+    try {
+        auto unit = std::make_shared<ParseUnit>(chunk.text, lineOffset);
+        unit->parseTranslationUnit();
+        chunk.unit = std::move(unit);
+    } catch (const std::exception &e) {
+        chunk.error = e.what();
+    }
+    return chunk;
+}
+
+void IncrementalProgram::update(std::string_view source) {
+    // Index the previous chunks by their text so unchanged ones can be reused
+    // wherever they moved to. Keys are views into the old chunks and the
+    // source is only copied for chunks that need parsing, so an edit to a
+    // large file doesn't copy the whole buffer.
+    std::unordered_map<std::string_view, size_t> previous;
+    previous.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        previous.try_emplace(chunks[i].text, i);
+    }
+
+    std::vector<Chunk> next;
+    next.reserve(chunks.size());
+    reparsed = 0;
+    for (const Span &span : splitTopLevel(source)) {
+        std::string_view text = source.substr(span.start, span.end - span.start);
+        auto it = previous.find(text);
+        // A chunk with a syntax error is reparsed if it moved, so the line in
+        // its message stays right.
+        if (it != previous.end() && (chunks[it->second].unit || chunks[it->second].lineOffset == span.lineOffset)) {
+            Chunk &reused = chunks[it->second];
+            // The key views reused.text, so drop it before moving the text out.
+            previous.erase(it);
+            reused.lineOffset = span.lineOffset;
+            next.push_back(std::move(reused));
+        } else {
+            next.push_back(parseChunk(std::string(text), span.lineOffset));
+            ++reparsed;
+        }
+    }
+    chunks = std::move(next);
+}
+
+std::vector<std::shared_ptr<ParseUnit>> IncrementalProgram::units() const {
+    std::vector<std::shared_ptr<ParseUnit>> result;
+    result.reserve(chunks.size());
+    for (const auto &chunk : chunks) {
+        if (chunk.unit) result.push_back(chunk.unit);
+    }
+    return result;
+}
+
+std::vector<std::string> IncrementalProgram::errors() const {
+    std::vector<std::string> result;
+    for (const auto &chunk : chunks) {
+        if (!chunk.unit) result.push_back(chunk.error);
+    }
+    return result;
+}
+
+bool IncrementalProgram::hasErrors() const {
+    for (const auto &chunk : chunks) {
+        if (!chunk.unit) return true;
+    }
+    return false;
+}
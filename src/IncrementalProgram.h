@@ -0,0 +1,46 @@
+#ifndef INCREMENTAL_PROGRAM_H
+#define INCREMENTAL_PROGRAM_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ParseUnit.h"
+
+// A file-mode program kept in parsed form between edits. The source is split
+// into its top-level declarations (function definitions and globals), each
+// parsed on its own; update() only reparses the declarations whose text
+// changed and reuses the parse trees of everything else.
+class IncrementalProgram {
+public:
+    // Re-splits the source and reparses changed declarations. Never throws:
+    // syntax errors are collected and reported through errors().
+    void update(std::string_view source);
+
+    // Parsed declarations in source order, ready for Interpreter::runProgram.
+    std::vector<std::shared_ptr<ParseUnit>> units() const;
+
+    // One message per declaration that failed to parse.
+    std::vector<std::string> errors() const;
+    bool hasErrors() const;
+
+    // Number of declarations parsed by the last update (the rest were reused).
+    size_t lastReparseCount() const { return reparsed; }
+    size_t declarationCount() const { return chunks.size(); }
+
+private:
+    struct Chunk {
+        std::string text;
+        size_t lineOffset = 0;              // newlines in the source before this chunk
+        std::shared_ptr<ParseUnit> unit;    // null if the chunk failed to parse
+        std::string error;
+    };
+
+    static Chunk parseChunk(std::string text, size_t lineOffset);
+
+    std::vector<Chunk> chunks;
+    size_t reparsed = 0;
+};
+
+#endif // INCREMENTAL_PROGRAM_H
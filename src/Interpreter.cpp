@@ -1,63 +1,16 @@
 #include "Interpreter.h"
-#include "CustomErrorListener.h"
 #include "EnvScopeGuard.h"
 #include "ReturnException.h"
+#include "Trace.h"
 
-Interpreter::Interpreter() {
-    globalEnv = new Environment(nullptr); // Global environment; no parent.
-}
-
-std::any Interpreter::evaluate(const std::string &code, bool isFileMode) {
-    // Create the input stream from the code.
-    antlr4::ANTLRInputStream inputStream(code);
-    CLexer lexer(&inputStream);
-    antlr4::CommonTokenStream tokens(&lexer);
-    CParser parser(&tokens);
-
-    parser.removeErrorListeners();
-    CustomErrorListener errorListener;
-    parser.addErrorListener(&errorListener);
-
-    std::any rawResult;
-    if (isFileMode) {
-        // For file mode, require a complete translation unit.
-        auto* tree = parser.translationUnit();
-        CInterpreterVisitor visitor(globalEnv, &tokens);
-        visitor.visit(tree); // register functions etc
-
-        // Now lookup and call main.
-        Function* mainFunc = globalEnv->getFunction("main");
-        if (!mainFunc) {
-            throw std::runtime_error("No main function defined.");
-        }
-
-        antlr4::ANTLRInputStream  bodyIn(mainFunc->bodyText);
-        CLexer                   bodyLex(&bodyIn);
-        antlr4::CommonTokenStream bodyTokens(&bodyLex);
-        CParser                  bodyParser(&bodyTokens);
-
-        auto* bodyCtx = bodyParser.compoundStatement();
-
-        // Create a new scope to execute main.
-        {
-            EnvScopeGuard guard(globalEnv);
-            try {
-                rawResult = visitor.visit(bodyCtx);
-            } catch (const ReturnException &retEx) {
-                rawResult = retEx.getValue();
-            }
-        }
-
+#include <cctype>
+#include <string_view>
+#include <utility>
 
+namespace {
 
-    } else {
-        // For REPL mode, be more flexible.
-        CParser::ReplInputContext *tree = parser.replInput();
-        CInterpreterVisitor visitor(globalEnv, &tokens);
-        rawResult = visitor.visit(tree);
-    }
-
-    // if the rawResult holds a VarValue, unwrap it.
+// if the rawResult holds a VarValue, unwrap it.
+std::any unwrapResult(const std::any &rawResult) {
     if (rawResult.type() == typeid(VarValue)) {
         VarValue value = std::any_cast<VarValue>(rawResult);
         // Unwrap the variant and return the plain type.
@@ -76,6 +29,257 @@ std::any Interpreter::evaluate(const std::string &code, bool isFileMode) {
     return rawResult;
 }
 
-Interpreter::~Interpreter() {
-    delete globalEnv; // Clean up the dynamically allocated global environment.
+// A global initialiser that can be cached as a value: a number or char
+// literal, optionally negated.
+bool isConstantInitializer(CParser::ExpressionContext *expr) {
+    std::string text = expr->getText();
+    std::string_view digits = text;
+    if (!digits.empty() && digits.front() == '-') {
+        digits.remove_prefix(1);
+    }
+    if (digits.size() == 3 && digits.front() == '\'' && digits.back() == '\'') {
+        return true;
+    }
+    if (digits.empty() || digits.front() == '.' || digits.back() == '.') {
+        return false;
+    }
+    int dots = 0;
+    for (char c : digits) {
+        if (c == '.') {
+            ++dots;
+        } else if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    return dots <= 1;
+}
+
+// Splits one evaluation's allocations into phases. Whatever was allocated
+// since the last enter() is charged to the phase entered then, including when
+// the evaluation leaves by exception.
+class PhaseAllocations {
+public:
+    explicit PhaseAllocations(EvaluationAllocations &out) : out(out), current(&out.lex) { out = {}; }
+    ~PhaseAllocations() { *current += scope.restart(); }
+
+    void enter(AllocationCounts EvaluationAllocations::*phase) {
+        *current += scope.restart();
+        current = &(out.*phase);
+    }
+
+private:
+    EvaluationAllocations &out;
+    AllocationCounts *current;
+    AllocationScope scope;
+};
+
+} // namespace
+
+Interpreter::Interpreter()
+    : globalEnv(std::make_unique<Environment>(nullptr)) {} // Global environment; no parent.
+
+Interpreter::Interpreter(std::shared_ptr<const Program> compiled)
+    : globalEnv(std::make_unique<Environment>(nullptr)), program(std::move(compiled)) {
+    for (const auto &[name, func] : program->functions()) {
+        globalEnv->defineFunction(name, func);
+    }
+    CInterpreterVisitor visitor(globalEnv.get(), program->parseUnit());
+    prepareVisitor(visitor);
+    for (auto *decl : program->globals()) {
+        visitor.visit(decl);
+    }
+}
+
+Interpreter::Interpreter(const Snapshot &snapshot)
+    : globalEnv(std::make_unique<Environment>(*snapshot)) {}
+
+Interpreter::Snapshot Interpreter::snapshot() const {
+    return std::make_shared<const Environment>(*globalEnv);
+}
+
+std::any Interpreter::run() {
+    return callMain();
+}
+
+std::any Interpreter::evaluate(std::string_view code, bool isFileMode) {
+    TRACE(VCI_TRACE_INFO, TraceEvent::Evaluate, static_cast<int64_t>(code.size()), isFileMode ? 1 : 0);
+    PhaseAllocations phases(lastAllocations);
+    // A cache hit needs no parse unit, so look it up before making one.
+    if (isFileMode && programCache) {
+        phases.enter(&EvaluationAllocations::parse);
+        if (auto cached = programCache->load(code)) {
+            phases.enter(&EvaluationAllocations::execute);
+            installCachedProgram(*cached);
+            return callMain();
+        }
+        phases.enter(&EvaluationAllocations::lex);
+    }
+    // The unit owns the input stream, lexer, tokens and parser, and lives on
+    // in any function defined by this code.
+    std::shared_ptr<ParseUnit> unit = parseUnitFor(code);
+
+    if (isFileMode) {
+        unit->lex();
+        phases.enter(&EvaluationAllocations::parse);
+        // For file mode, require a complete translation unit.
+        auto *tree = unit->parseTranslationUnit();
+        phases.enter(&EvaluationAllocations::execute);
+        if (!programCache) {
+            return runProgram({unit});
+        }
+        programCache->store(code, registerAndIndex(tree, unit));
+        return callMain();
+    }
+
+    // For REPL mode, be more flexible.
+    unit->lex();
+    phases.enter(&EvaluationAllocations::parse);
+    CParser::ReplInputContext *tree = unit->parseReplInput();
+    phases.enter(&EvaluationAllocations::execute);
+    Profiler::CallScope profileScope(activeProfiler.get(), "(toplevel)");
+    CInterpreterVisitor visitor(globalEnv.get(), unit);
+    prepareVisitor(visitor);
+    return unwrapResult(visitor.visit(tree));
+}
+
+std::any Interpreter::evaluate(std::string_view code, bool isFileMode, const ExecutionBudget &budget) {
+    BudgetMeter meter(budget);
+    BudgetMeter *previous = std::exchange(budgetMeter, &meter);
+    try {
+        std::any result = evaluate(code, isFileMode);
+        budgetMeter = previous;
+        return result;
+    } catch (...) {
+        budgetMeter = previous;
+        throw;
+    }
+}
+
+std::shared_ptr<ParseUnit> Interpreter::parseUnitFor(std::string_view code) {
+    // Most REPL lines define no function, so nothing from them outlives the
+    // evaluation and the next one can reuse their pipeline: building a fresh
+    // lexer, token stream and parser is most of the cost of a short line.
+    if (lastUnit && lastUnit.use_count() == 1) {
+        lastUnit->reset(code);
+    } else {
+        lastUnit = std::make_shared<ParseUnit>(code);
+    }
+    return lastUnit;
+}
+
+void Interpreter::prepareVisitor(CInterpreterVisitor &visitor) {
+    visitor.setExecutionControl(executionControl);
+    visitor.setOutput(programOutput.get());
+    visitor.setBudgetMeter(budgetMeter);
+    visitor.setProfiler(activeProfiler.get());
+    visitor.setOptimizerOptions(optimizerOptions);
+}
+
+void Interpreter::enableProfiling(bool enabled) {
+    if (!enabled) {
+        activeProfiler.reset();
+    } else if (!activeProfiler) {
+        activeProfiler = std::make_unique<Profiler>();
+    }
+}
+
+void Interpreter::defineHostFunction(const std::string &name, std::shared_ptr<const Function> func) {
+    if (findBuiltin(name)) {
+        throw std::runtime_error("'" + name + "' is a builtin function and cannot be redefined.");
+    }
+    globalEnv->defineFunction(name, std::move(func));
+}
+
+std::any Interpreter::runProgram(const std::vector<std::shared_ptr<ParseUnit>> &units) {
+    for (const auto &unit : units) {
+        CInterpreterVisitor visitor(globalEnv.get(), unit);
+        prepareVisitor(visitor);
+        visitor.visit(unit->tree()); // register functions etc
+    }
+    return callMain();
 }
+
+std::any Interpreter::callMain() {
+    // Now lookup and call main.
+    const Function* mainFunc = globalEnv->getFunction("main");
+    const FunctionBody *mainBody = mainFunc ? &mainFunc->compiled() : nullptr;
+    if (!mainBody || !mainBody->tree) {
+        throw std::runtime_error("No main function defined.");
+    }
+
+    // Create a new scope to execute main.
+    Environment* env = globalEnv.get();
+    CInterpreterVisitor visitor(env, mainBody->unit);
+    prepareVisitor(visitor);
+    std::any rawResult;
+    {
+        Profiler::CallScope profileScope(activeProfiler.get(), "main");
+        EnvScopeGuard guard(env);
+        try {
+            rawResult = visitor.visit(mainBody->tree);
+        } catch (const ReturnException &retEx) {
+            rawResult = retEx.getValue();
+        }
+    }
+    return unwrapResult(rawResult);
+}
+
+void Interpreter::enableProgramCache(const std::string &directory) {
+    programCache = std::make_unique<ProgramCache>(directory);
+}
+
+CachedProgram Interpreter::registerAndIndex(CParser::TranslationUnitContext *tree,
+                                            const std::shared_ptr<ParseUnit> &unit) {
+    CachedProgram program;
+    CInterpreterVisitor visitor(globalEnv.get(), unit);
+    prepareVisitor(visitor);
+    // Visit one declaration at a time so each global's value can be read back
+    // straight after its own initialiser ran.
+    for (auto *decl : tree->externalDeclaration()) {
+        visitor.visit(decl);
+
+        CachedDeclaration entry;
+        if (auto *fn = decl->functionDefinition()) {
+            entry.kind = CachedDeclaration::Kind::Function;
+            entry.name = fn->IDENTIFIER()->getText();
+            const Function *func = globalEnv->getFunction(entry.name);
+            entry.function.returnType = func->returnType;
+            entry.function.parameterTypes = func->parameterTypes;
+            entry.function.parameterNames = func->parameterNames;
+            entry.function.bodyText = func->bodyText;
+        } else if (auto *var = dynamic_cast<CParser::DeclareVariableContext *>(decl->declaration());
+                   var && (!var->expression() || isConstantInitializer(var->expression()))) {
+            entry.kind = CachedDeclaration::Kind::GlobalValue;
+            entry.name = var->declarator()->getText();
+            entry.value = globalEnv->get(entry.name);
+        } else {
+            entry.kind = CachedDeclaration::Kind::GlobalSource;
+            entry.source = unit->textOf(decl);
+        }
+        program.declarations.push_back(std::move(entry));
+    }
+    return program;
+}
+
+void Interpreter::installCachedProgram(const CachedProgram &program) {
+    for (const auto &decl : program.declarations) {
+        switch (decl.kind) {
+            case CachedDeclaration::Kind::Function:
+                globalEnv->defineFunction(decl.name, compileFunction(decl.function));
+                break;
+            case CachedDeclaration::Kind::GlobalValue:
+                globalEnv->define(decl.name, decl.value.type, decl.value.value);
+                break;
+            case CachedDeclaration::Kind::GlobalSource: {
+                auto unit = std::make_shared<ParseUnit>(decl.source);
+                auto *tree = unit->parseReplInput();
+                CInterpreterVisitor visitor(globalEnv.get(), unit);
+                prepareVisitor(visitor);
+                visitor.visit(tree);
+                break;
+            }
+        }
+    }
+}
+
+Interpreter::~Interpreter() = default;
@@ -2,22 +2,150 @@
 #define INTERPRETER_H
 
 #include <string>
+#include <string_view>
 #include <any>
+#include <memory>
+#include <vector>
 #include "antlr4-runtime.h"
+#include "AllocationTracker.h"
 #include "CLexer.h"
 #include "CParser.h"
 #include "CInterpreterVisitor.h"
+#include "FunctionHandle.h"
+#include "HostFunction.h"
+#include "ParseUnit.h"
+#include "Program.h"
+#include "ProgramCache.h"
+#include "ProgramOutput.h"
 
+// An Interpreter is an isolate: it owns its globals and call stack and may be
+// used by one thread at a time. Any number of isolates can share one compiled
+// Program and run it concurrently on different threads.
 class Interpreter {
 public:
     Interpreter();
 
+    // Creates an isolate for `program`: its functions are shared, and its
+    // global declarations are run against this isolate's own environment.
+    explicit Interpreter(std::shared_ptr<const Program> program);
+
+    // Session forking. snapshot() freezes this interpreter's globals
+    // (variables and functions) in O(1); any number of interpreters, on any
+    // threads, can then be started from the snapshot, also in O(1). They share
+    // everything until they write to it (see Environment), so changes made
+    // after the snapshot, here or in a fork, are not seen by the others:
+    //     auto prelude = base.snapshot();
+    //     Interpreter trial(prelude);   // try something out
+    //     Interpreter other(prelude);   // unaffected by trial
+    // Only call snapshot() from the thread using this interpreter.
+    using Snapshot = std::shared_ptr<const Environment>;
+    Snapshot snapshot() const;
+    explicit Interpreter(const Snapshot &snapshot);
+
+    Interpreter(const Interpreter &) = delete;
+    Interpreter &operator=(const Interpreter &) = delete;
+
     // Evaluates a string of C code and returns the result as std::any.
-    std::any evaluate(const std::string &code, bool isFileMode);
+    // The code is only read for the duration of the call, so callers can pass
+    // a view of a mapped file or an editor buffer without copying it.
+    std::any evaluate(std::string_view code, bool isFileMode);
+
+    // Same, under hard limits: throws BudgetExceeded as soon as the
+    // evaluation uses more steps, call depth or time than `budget` allows.
+    std::any evaluate(std::string_view code, bool isFileMode, const ExecutionBudget &budget);
+
+    // Runs an already-parsed program: each unit's tree is visited in order
+    // (registering functions and globals) and then main is called. Used by the
+    // editor, which keeps its parse trees between runs (see IncrementalProgram).
+    std::any runProgram(const std::vector<std::shared_ptr<ParseUnit>> &units);
+
+    // Caches file-mode programs in `directory`: a later evaluate() of the same
+    // source registers its declarations from the cache instead of parsing.
+    void enableProgramCache(const std::string &directory);
+
+    // Calls main in this isolate's environment.
+    std::any run();
+
+    // Lets another thread cancel evaluations of this interpreter through
+    // `control` (see ExecutionControl). Pass nullptr to detach.
+    void setExecutionControl(ExecutionControl *control) { executionControl = control; }
+
+    // Profiling (off by default): while enabled, every evaluation is recorded
+    // into profiler(), which accumulates until reset. Top-level REPL code is
+    // attributed to a "(toplevel)" frame.
+    void enableProfiling(bool enabled);
+    Profiler *profiler() { return activeProfiler.get(); }
+
+    // All optimizations are on by default. They never change results, so
+    // turning them off is mostly useful for comparing against them.
+    void setOptimizerOptions(const OptimizerOptions &options) { optimizerOptions = options; }
+
+    // What the program printed with printf, putchar and puts. It accumulates
+    // across evaluations until drained or flushed (see ProgramOutput).
+    ProgramOutput &output() { return *programOutput; }
+
+    // Heap allocations made by the most recent evaluate(), by phase (all zero
+    // in builds without VCI_TRACK_ALLOCATIONS).
+    const EvaluationAllocations &lastEvaluationAllocations() const { return lastAllocations; }
+
+    // Embedding API: a typed handle to a global function, for hosts that call
+    // it many times, e.g.
+    //     Interpreter rules(Program::compile(source));
+    //     auto score = rules.function<int(int, double)>("score");
+    //     int s = score(3, 0.5);
+    // Throws std::runtime_error if the function is missing or its signature
+    // differs from Signature.
+    template<typename Signature>
+    FunctionHandle<Signature> function(const std::string &name) const {
+        return FunctionHandle<Signature>(globalEnv.get(), executionControl, programOutput.get(), name,
+                                         globalEnv->getFunctionShared(name));
+    }
+
+    // The other direction: makes a C++ callable available to scripts as a
+    // global function, e.g.
+    //     interpreter.defineFunction<double(int, double)>("weight",
+    //         [&](int id, double base) { return table[id] * base; });
+    //     interpreter.evaluate("weight(3, 0.5);", false);
+    // Scripts call it like any function, with arguments converted to the
+    // signature's types. It is shared with snapshots and, like a function
+    // defined in C, replaced by a later definition of the same name. The
+    // optimizer assumes each call has side effects. Throws std::runtime_error
+    // for a builtin's name.
+    template<typename Signature, typename F>
+    void defineFunction(const std::string &name, F &&callable) {
+        defineHostFunction(name, HostFunction<Signature>::make(std::forward<F>(callable)));
+    }
 
     ~Interpreter();
 private:
-    Environment* globalEnv;
+    void defineHostFunction(const std::string &name, std::shared_ptr<const Function> func);
+
+    // Looks up main in the global environment and runs its body.
+    std::any callMain();
+
+    // A parse unit holding `code`: the previous evaluation's, reset, if no
+    // function defined by that code still refers to it; otherwise a new one.
+    std::shared_ptr<ParseUnit> parseUnitFor(std::string_view code);
+
+    // Hooks a new visitor up to the current cancellation flag, budget and
+    // output.
+    void prepareVisitor(CInterpreterVisitor &visitor);
+
+    // Program cache helpers: register a parsed translation unit while recording
+    // its declarations, and replay a cached declaration list.
+    CachedProgram registerAndIndex(CParser::TranslationUnitContext *tree, const std::shared_ptr<ParseUnit> &unit);
+    void installCachedProgram(const CachedProgram &program);
+
+    std::unique_ptr<Environment> globalEnv;
+    std::shared_ptr<const Program> program;
+    std::unique_ptr<ProgramCache> programCache;
+    ExecutionControl *executionControl = nullptr;
+    BudgetMeter *budgetMeter = nullptr; // set only during a budgeted evaluate()
+    std::unique_ptr<Profiler> activeProfiler;
+    std::unique_ptr<ProgramOutput> programOutput = std::make_unique<ProgramOutput>();
+    OptimizerOptions optimizerOptions;
+    EvaluationAllocations lastAllocations;
+    std::shared_ptr<ParseUnit> lastUnit;
 };
 
 #endif // INTERPRETER_H
@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. The contents are available as a
+// string_view for as long as the MappedFile lives; nothing is copied.
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file can't be opened or mapped.
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    const char *data() const { return static_cast<const char *>(addr); }
+    size_t size() const { return length; }
+    std::string_view view() const { return {data(), length}; }
+
+private:
+    void *addr = nullptr;
+    size_t length = 0;
+};
+
+#endif // MAPPED_FILE_H
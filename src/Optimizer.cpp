@@ -0,0 +1,529 @@
+// Optimizer.cpp
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <typeinfo>
+#include <unordered_set>
+
+#include "Builtins.h"
+#include "Environment.h"
+
+namespace {
+
+using antlr4::tree::ParseTree;
+
+void sortUnique(std::vector<std::string> &names) {
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+bool intersects(const std::vector<std::string> &names, const std::vector<std::string> &sorted) {
+    return std::any_of(names.begin(), names.end(), [&](const std::string &name) {
+        return std::binary_search(sorted.begin(), sorted.end(), name);
+    });
+}
+
+// What calling a builtin does, as far as the analyses are concerned: it
+// writes to the program's output, which no variable can read.
+const std::string kOutputEffect = "(output)";
+
+// Likewise for host functions, whose state no variable can read either.
+const std::string kHostEffect = "(host)";
+
+// node as a string literal, if that is all it is under any number of
+// single-child rules, or nullptr.
+CParser::StringLiteralContext *asStringLiteral(ParseTree *node) {
+    while (node->children.size() == 1 && !dynamic_cast<CParser::StringLiteralContext *>(node)) {
+        node = node->children.front();
+    }
+    return dynamic_cast<CParser::StringLiteralContext *>(node);
+}
+
+// node as a call expression, or nullptr if it is anything else.
+CParser::PostfixExpressionContext *asCall(ParseTree *node) {
+    auto *postfix = dynamic_cast<CParser::PostfixExpressionContext *>(node);
+    return postfix && postfix->children.size() > 1 ? postfix : nullptr;
+}
+
+std::string calleeName(CParser::PostfixExpressionContext *call) {
+    return call->primaryExpression()->getText();
+}
+
+// The variable node assigns or declares, or "" if it does neither.
+std::string writtenName(ParseTree *node) {
+    if (auto *assign = dynamic_cast<CParser::AssignmentExprContext *>(node)) {
+        return assign->unaryExpression()->getText();
+    }
+    if (auto *decl = dynamic_cast<CParser::DeclareVariableContext *>(node)) {
+        return decl->declarator()->getText();
+    }
+    if (auto *decl = dynamic_cast<CParser::ForDeclarationContext *>(node)) {
+        return decl->declarator()->getText();
+    }
+    return {};
+}
+
+// Operations worth caching: nodes that compute something, as opposed to
+// variables, literals and the one-operand links of the grammar's precedence
+// chain (which the visitor passes straight through).
+bool isOperation(ParseTree *node) {
+    if (dynamic_cast<CParser::UnaryMinusExpressionContext *>(node) ||
+        dynamic_cast<CParser::LogicalNotExpressionContext *>(node) || asCall(node)) {
+        return true;
+    }
+    if (node->children.size() < 2) {
+        return false;
+    }
+    return dynamic_cast<CParser::LogicalOrExpressionContext *>(node) ||
+           dynamic_cast<CParser::LogicalAndExpressionContext *>(node) ||
+           dynamic_cast<CParser::EqualityExpressionContext *>(node) ||
+           dynamic_cast<CParser::RelationalExpressionContext *>(node) ||
+           dynamic_cast<CParser::AddSubExpressionContext *>(node) ||
+           dynamic_cast<CParser::MulDivExpressionContext *>(node);
+}
+
+void collectWritesAndCalls(ParseTree *node, LoopPlan &plan) {
+    if (std::string name = writtenName(node); !name.empty()) {
+        plan.writes.push_back(std::move(name));
+    } else if (auto *call = asCall(node)) {
+        plan.calls.push_back(calleeName(call));
+    }
+    for (auto *child : node->children) {
+        collectWritesAndCalls(child, plan);
+    }
+}
+
+struct Uses {
+    std::vector<std::string> reads;
+    std::vector<std::string> calls;
+    bool writes = false;
+};
+
+// Adds every operation under node that reads nothing plan.writes contains,
+// and assigns nothing, to plan.invariants. Returns what node itself uses.
+Uses findInvariants(ParseTree *node, LoopPlan &plan) {
+    Uses uses;
+    for (auto *child : node->children) {
+        Uses inner = findInvariants(child, plan);
+        uses.reads.insert(uses.reads.end(), inner.reads.begin(), inner.reads.end());
+        uses.calls.insert(uses.calls.end(), inner.calls.begin(), inner.calls.end());
+        uses.writes = uses.writes || inner.writes;
+    }
+    if (dynamic_cast<CParser::VariableReferenceContext *>(node)) {
+        uses.reads.push_back(node->getText());
+    } else if (!writtenName(node).empty()) {
+        uses.writes = true;
+    } else if (auto *call = asCall(node)) {
+        uses.calls.push_back(calleeName(call));
+    }
+
+    if (!uses.writes && isOperation(node) && !intersects(uses.reads, plan.writes)) {
+        LoopPlan::Invariant invariant{static_cast<antlr4::ParserRuleContext *>(node), uses.reads, uses.calls};
+        sortUnique(invariant.reads);
+        sortUnique(invariant.calls);
+        plan.invariants.push_back(std::move(invariant));
+    }
+    return uses;
+}
+
+// Finds repeated operations in one block, following the order in which the
+// visitor evaluates it: operands before operators, left to right, and an
+// assignment's right-hand side before the assignment.
+class RepeatScanner {
+public:
+    explicit RepeatScanner(BlockPlan &plan) : plan(plan) {}
+
+    // One child of a block: a declaration or statement, or a brace.
+    void scanItem(ParseTree *item) {
+        if (auto *stmt = dynamic_cast<CParser::StatementContext *>(item)) {
+            if (auto *exprStmt = stmt->expressionStatement()) {
+                if (exprStmt->expression()) {
+                    scanExpression(exprStmt->expression());
+                }
+                return;
+            }
+            if (stmt->declaration()) {
+                scanItem(stmt->declaration());
+                return;
+            }
+            // The rest end the run, though an if's condition or a returned
+            // value is still computed first.
+            if (auto *ret = dynamic_cast<CParser::ReturnStmtContext *>(stmt->jumpStatement()); ret && ret->expression()) {
+                scanExpression(ret->expression());
+            } else if (auto *branch = dynamic_cast<CParser::IfElseStatementContext *>(stmt->selectionStatement())) {
+                scanExpression(branch->expression());
+            }
+        } else if (auto *external = dynamic_cast<CParser::ExternalDeclarationContext *>(item)) {
+            if (external->declaration()) {
+                scanItem(external->declaration());
+                return;
+            }
+        } else if (auto *decl = dynamic_cast<CParser::DeclareVariableContext *>(item)) {
+            if (decl->expression()) {
+                scanExpression(decl->expression());
+            }
+            kill(decl->declarator()->getText());
+            return;
+        }
+        computed.clear();
+    }
+
+private:
+    struct Computed {
+        const antlr4::ParserRuleContext *node;
+        std::string text;
+        std::vector<std::string> reads;       // sorted
+        std::vector<std::string> callsSince;
+    };
+
+    Uses scanExpression(ParseTree *node) {
+        if (auto *assign = dynamic_cast<CParser::AssignmentExprContext *>(node)) {
+            Uses uses = scanExpression(assign->assignmentExpression());
+            kill(assign->unaryExpression()->getText());
+            uses.writes = true;
+            return uses;
+        }
+
+        // Same operator and operands as something computed earlier. Its
+        // operands are then computed too, so there is no need to look inside.
+        const bool operation = isOperation(node) && !asCall(node);
+        std::string text = operation ? node->getText() : std::string();
+        if (operation) {
+            auto earlier = std::find_if(computed.begin(), computed.end(), [&](const Computed &c) {
+                return c.text == text && typeid(*c.node) == typeid(*node);
+            });
+            if (earlier != computed.end()) {
+                BlockPlan::Repeat repeat{earlier->node, static_cast<antlr4::ParserRuleContext *>(node),
+                                         earlier->reads, earlier->callsSince};
+                sortUnique(repeat.callsBetween);
+                plan.repeats.push_back(std::move(repeat));
+                Uses uses;
+                uses.reads = earlier->reads;
+                return uses;
+            }
+        }
+
+        Uses uses;
+        for (auto *child : node->children) {
+            Uses inner = scanExpression(child);
+            uses.reads.insert(uses.reads.end(), inner.reads.begin(), inner.reads.end());
+            uses.calls.insert(uses.calls.end(), inner.calls.begin(), inner.calls.end());
+            uses.writes = uses.writes || inner.writes;
+        }
+        if (dynamic_cast<CParser::VariableReferenceContext *>(node)) {
+            uses.reads.push_back(node->getText());
+        } else if (auto *call = asCall(node)) {
+            std::string name = calleeName(call);
+            for (auto &c : computed) {
+                c.callsSince.push_back(name);
+            }
+            uses.calls.push_back(std::move(name));
+        }
+
+        if (operation && uses.calls.empty() && !uses.writes) {
+            std::vector<std::string> reads = uses.reads;
+            sortUnique(reads);
+            computed.push_back({static_cast<antlr4::ParserRuleContext *>(node), std::move(text), std::move(reads), {}});
+        }
+        return uses;
+    }
+
+    // Values that read `name` are stale once it is assigned or redeclared.
+    void kill(const std::string &name) {
+        std::erase_if(computed, [&](const Computed &c) {
+            return std::binary_search(c.reads.begin(), c.reads.end(), name);
+        });
+    }
+
+    BlockPlan &plan;
+    std::vector<Computed> computed;
+};
+
+// What the functions reachable from `roots` read and assign outside their own
+// scopes, with kOutputEffect among the writes if any of them prints. Returns
+// false if one of them is not defined, in which case the loop will fail when it
+// gets to that call and there is nothing to gain.
+bool reachableEffects(const Environment &env, const std::vector<std::string> &roots,
+                      std::vector<std::string> &reads, std::vector<std::string> &writes) {
+    std::vector<std::string> pending(roots);
+    std::unordered_set<std::string> seen(roots.begin(), roots.end());
+    while (!pending.empty()) {
+        std::string name = std::move(pending.back());
+        pending.pop_back();
+        if (findBuiltin(name)) {
+            writes.push_back(kOutputEffect);
+            continue;
+        }
+        const Function *func = env.getFunction(name);
+        if (!func) {
+            return false;
+        }
+        const FunctionEffects &effects = func->compiled().effects;
+        reads.insert(reads.end(), effects.globalReads.begin(), effects.globalReads.end());
+        writes.insert(writes.end(), effects.globalWrites.begin(), effects.globalWrites.end());
+        for (const auto &callee : effects.callees) {
+            if (seen.insert(callee).second) {
+                pending.push_back(callee);
+            }
+        }
+    }
+    sortUnique(reads);
+    sortUnique(writes);
+    return true;
+}
+
+// Walks a function body, tracking the names declared in each enclosing block,
+// to find the ones it uses from outside.
+class EffectScanner {
+public:
+    explicit EffectScanner(const std::vector<std::string> &parameterNames) : scopes{parameterNames} {}
+
+    void scan(ParseTree *node) {
+        bool opensScope = dynamic_cast<CParser::CompoundStatementContext *>(node) ||
+                          dynamic_cast<CParser::ForStatementContext *>(node);
+        if (opensScope) {
+            scopes.emplace_back();
+        }
+
+        if (auto *decl = dynamic_cast<CParser::DeclareVariableContext *>(node)) {
+            // The initialiser runs before the name exists.
+            if (decl->expression()) {
+                scan(decl->expression());
+            }
+            scopes.back().push_back(decl->declarator()->getText());
+        } else if (auto *decl = dynamic_cast<CParser::ForDeclarationContext *>(node)) {
+            if (decl->expression()) {
+                scan(decl->expression());
+            }
+            scopes.back().push_back(decl->declarator()->getText());
+        } else if (auto *assign = dynamic_cast<CParser::AssignmentExprContext *>(node)) {
+            scan(assign->assignmentExpression());
+            std::string target = assign->unaryExpression()->getText();
+            if (!declared(target)) {
+                effects.globalWrites.push_back(std::move(target));
+            }
+        } else {
+            if (dynamic_cast<CParser::VariableReferenceContext *>(node)) {
+                if (std::string name = node->getText(); !declared(name)) {
+                    effects.globalReads.push_back(std::move(name));
+                }
+            } else if (auto *call = asCall(node)) {
+                effects.callees.push_back(calleeName(call));
+            }
+            for (auto *child : node->children) {
+                scan(child);
+            }
+        }
+
+        if (opensScope) {
+            scopes.pop_back();
+        }
+    }
+
+    FunctionEffects effects;
+
+private:
+    bool declared(const std::string &name) const {
+        return std::any_of(scopes.begin(), scopes.end(), [&](const std::vector<std::string> &scope) {
+            return std::find(scope.begin(), scope.end(), name) != scope.end();
+        });
+    }
+
+    std::vector<std::vector<std::string>> scopes;
+};
+
+} // namespace
+
+OptimizationPlan::OptimizationPlan(antlr4::ParserRuleContext *root) {
+    if (root) {
+        analyze(root);
+    }
+}
+
+const LoopPlan *OptimizationPlan::loop(const antlr4::ParserRuleContext *loopNode) const {
+    auto it = loops.find(loopNode);
+    return it == loops.end() ? nullptr : &it->second;
+}
+
+const BlockPlan *OptimizationPlan::block(const antlr4::ParserRuleContext *blockNode) const {
+    auto it = blocks.find(blockNode);
+    return it == blocks.end() ? nullptr : &it->second;
+}
+
+const std::string *OptimizationPlan::stringArgument(const antlr4::ParserRuleContext *argument) const {
+    auto it = strings.find(argument);
+    return it == strings.end() ? nullptr : &it->second;
+}
+
+void OptimizationPlan::analyze(antlr4::tree::ParseTree *node) {
+    if (auto *block = dynamic_cast<CParser::CompoundStatementContext *>(node)) {
+        analyzeBlock(block);
+    } else if (auto *line = dynamic_cast<CParser::ReplInputContext *>(node)) {
+        // Calls are checked when the block starts, which would be before a
+        // function defined further down the line exists.
+        bool definesFunctions = std::ranges::any_of(line->externalDeclaration(), [](auto *decl) {
+            return decl->functionDefinition() != nullptr;
+        });
+        if (!definesFunctions) {
+            analyzeBlock(line);
+        }
+    } else if (auto *loop = dynamic_cast<CParser::WhileStatementContext *>(node)) {
+        analyzeLoop(loop, {loop->expression(), loop->statement()});
+    } else if (auto *loop = dynamic_cast<CParser::DoWhileStatementContext *>(node)) {
+        analyzeLoop(loop, {loop->statement(), loop->expression()});
+    } else if (auto *loop = dynamic_cast<CParser::ForStatementContext *>(node)) {
+        // The initialiser runs once, so only the rest of the header repeats.
+        auto *header = loop->forCondition();
+        std::vector<antlr4::tree::ParseTree *> repeated{loop->statement()};
+        if (header->forConditionExpression()) {
+            repeated.push_back(header->forConditionExpression());
+        }
+        if (header->forUpdateExpression()) {
+            repeated.push_back(header->forUpdateExpression());
+        }
+        analyzeLoop(loop, repeated);
+    } else if (auto *args = dynamic_cast<CParser::ArgumentExpressionListContext *>(node)) {
+        for (auto *arg : args->children) {
+            if (auto *literal = asStringLiteral(arg)) {
+                strings.emplace(static_cast<antlr4::ParserRuleContext *>(arg), decodeStringLiteral(literal->getText()));
+            }
+        }
+    }
+    for (auto *child : node->children) {
+        analyze(child);
+    }
+}
+
+void OptimizationPlan::analyzeLoop(antlr4::ParserRuleContext *loopNode,
+                                   const std::vector<antlr4::tree::ParseTree *> &repeated) {
+    LoopPlan plan;
+    for (auto *part : repeated) {
+        collectWritesAndCalls(part, plan);
+    }
+    sortUnique(plan.writes);
+    sortUnique(plan.calls);
+    for (auto *part : repeated) {
+        findInvariants(part, plan);
+    }
+    if (!plan.invariants.empty()) {
+        loops.emplace(loopNode, std::move(plan));
+    }
+}
+
+void OptimizationPlan::analyzeBlock(antlr4::ParserRuleContext *blockNode) {
+    BlockPlan plan;
+    RepeatScanner scanner(plan);
+    for (auto *item : blockNode->children) {
+        scanner.scanItem(item);
+    }
+    if (!plan.repeats.empty()) {
+        blocks.emplace(blockNode, std::move(plan));
+    }
+}
+
+void selectInvariants(const LoopPlan &loop, const Environment &env,
+                      std::vector<const antlr4::ParserRuleContext *> &out) {
+    if (loop.calls.empty()) {
+        for (const auto &invariant : loop.invariants) {
+            out.push_back(invariant.node);
+        }
+        return;
+    }
+
+    // Functions called anywhere in the loop may assign globals too.
+    std::vector<std::string> reads;
+    std::vector<std::string> writes;
+    if (!reachableEffects(env, loop.calls, reads, writes)) {
+        return;
+    }
+    writes.insert(writes.end(), loop.writes.begin(), loop.writes.end());
+    sortUnique(writes);
+
+    for (const auto &invariant : loop.invariants) {
+        if (intersects(invariant.reads, writes)) {
+            continue;
+        }
+        if (!invariant.calls.empty()) {
+            std::vector<std::string> calleeReads;
+            std::vector<std::string> calleeWrites;
+            if (!reachableEffects(env, invariant.calls, calleeReads, calleeWrites) ||
+                !calleeWrites.empty() || intersects(calleeReads, writes)) {
+                continue;
+            }
+        }
+        out.push_back(invariant.node);
+    }
+}
+
+void selectRepeats(const BlockPlan &block, const Environment &env,
+                   std::vector<const BlockPlan::Repeat *> &out) {
+    for (const auto &repeat : block.repeats) {
+        if (!repeat.callsBetween.empty()) {
+            std::vector<std::string> reads;
+            std::vector<std::string> writes;
+            if (!reachableEffects(env, repeat.callsBetween, reads, writes) || intersects(repeat.reads, writes)) {
+                continue;
+            }
+        }
+        out.push_back(&repeat);
+    }
+}
+
+FunctionEffects analyzeFunction(const std::vector<std::string> &parameterNames,
+                                CParser::CompoundStatementContext *body) {
+    EffectScanner scanner(parameterNames);
+    if (body) {
+        scanner.scan(body);
+    }
+    sortUnique(scanner.effects.globalReads);
+    sortUnique(scanner.effects.globalWrites);
+    sortUnique(scanner.effects.callees);
+    return std::move(scanner.effects);
+}
+
+FunctionEffects hostFunctionEffects() {
+    FunctionEffects effects;
+    effects.globalWrites.push_back(kHostEffect);
+    return effects;
+}
+
+std::optional<InlineBody> analyzeInline(const std::vector<std::string> &parameterNames,
+                                        CParser::CompoundStatementContext *body) {
+    if (!body || body->getStop()->getTokenIndex() - body->getStart()->getTokenIndex() + 1 > kMaxInlineTokens) {
+        return std::nullopt;
+    }
+    std::vector<std::string> names(parameterNames);
+    auto declaresNewName = [&](CParser::DeclarationContext *decl) {
+        auto *var = dynamic_cast<CParser::DeclareVariableContext *>(decl);
+        if (!var || std::ranges::find(names, var->declarator()->getText()) != names.end()) {
+            return false;
+        }
+        names.push_back(var->declarator()->getText());
+        return true;
+    };
+
+    InlineBody inlined;
+    for (auto *decl : body->declaration()) {
+        if (!declaresNewName(decl)) {
+            return std::nullopt;
+        }
+        inlined.steps.push_back(decl);
+    }
+    auto statements = body->statement();
+    if (statements.empty()) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i + 1 < statements.size(); ++i) {
+        auto *stmt = statements[i];
+        if (stmt->declaration() ? !declaresNewName(stmt->declaration()) : !stmt->expressionStatement()) {
+            return std::nullopt;
+        }
+        inlined.steps.push_back(stmt);
+    }
+    auto *ret = dynamic_cast<CParser::ReturnStmtContext *>(statements.back()->jumpStatement());
+    if (!ret || !ret->expression()) {
+        return std::nullopt;
+    }
+    inlined.result = ret->expression();
+    return inlined;
+}
@@ -0,0 +1,125 @@
+// Optimizer.h
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "antlr4-runtime.h"
+#include "CParser.h"
+#include "Function.h"
+
+class Environment;
+
+// Which optimizations the visitor applies. All are on by default; turning one
+// off must never change a program's results, which is what the differential
+// tests check.
+struct OptimizerOptions {
+    bool hoistLoopInvariants = true;
+    bool eliminateCommonSubexpressions = true;
+    bool inlineSmallFunctions = true;
+};
+
+// Inlining limits: only bodies of at most kMaxInlineTokens tokens are inlined,
+// and at most kMaxInlineDepth inlined calls run inside one another before the
+// next one takes the normal call path.
+constexpr size_t kMaxInlineTokens = 48;
+constexpr unsigned kMaxInlineDepth = 4;
+
+// Loop-invariant code motion. The tree is never rewritten: an invariant is a
+// side-effect-free operation inside the loop (condition, body or update) whose
+// variables the loop never assigns or declares. The visitor evaluates each one
+// the first time the loop reaches it and reuses the value for the rest of that
+// run of the loop. Computing it on first use rather than up front keeps loops
+// that run zero times, and invariants that would fail (e.g. divide by zero),
+// behaving exactly as they did without the optimization.
+struct LoopPlan {
+    struct Invariant {
+        const antlr4::ParserRuleContext *node;
+        std::vector<std::string> reads; // variables, sorted
+        std::vector<std::string> calls; // functions, sorted
+    };
+    std::vector<Invariant> invariants;
+
+    // Everything the loop assigns or declares and every function it calls,
+    // sorted. Calls are only resolved when the loop starts (selectInvariants),
+    // since REPL code can redefine functions between runs.
+    std::vector<std::string> writes;
+    std::vector<std::string> calls;
+};
+
+// Common subexpression elimination in straight-line code: a run of
+// declarations and expression statements (in a block or a REPL line) up to the
+// next statement that branches, loops, returns or opens a block. An operation
+// that was already computed earlier in the run, with none of its variables
+// assigned or declared since, takes the earlier value instead of being
+// evaluated again. Operations containing calls are never reused. Calls made
+// between the two occurrences are checked when the block starts
+// (selectRepeats), just like the calls in a loop.
+struct BlockPlan {
+    struct Repeat {
+        const antlr4::ParserRuleContext *first;
+        const antlr4::ParserRuleContext *repeat;
+        std::vector<std::string> reads;        // sorted
+        std::vector<std::string> callsBetween; // sorted
+    };
+    std::vector<Repeat> repeats;
+};
+
+// The analyses for one parse tree, and its decoded string literals, built once
+// by ParseUnit after parsing and read-only afterwards, so isolates running the
+// same tree can share it.
+class OptimizationPlan {
+public:
+    explicit OptimizationPlan(antlr4::ParserRuleContext *root);
+
+    // nullptr if the loop has no invariants.
+    const LoopPlan *loop(const antlr4::ParserRuleContext *loopNode) const;
+
+    // For compound statements and REPL lines; nullptr if nothing repeats.
+    const BlockPlan *block(const antlr4::ParserRuleContext *blockNode) const;
+
+    // A call argument that is nothing but a string literal, with its escapes
+    // decoded; nullptr for any other argument. Decoded once here so builtins
+    // can print it on every call without decoding or allocating.
+    const std::string *stringArgument(const antlr4::ParserRuleContext *argument) const;
+
+private:
+    void analyze(antlr4::tree::ParseTree *node);
+    void analyzeLoop(antlr4::ParserRuleContext *loopNode, const std::vector<antlr4::tree::ParseTree *> &repeated);
+    void analyzeBlock(antlr4::ParserRuleContext *blockNode);
+
+    std::unordered_map<const antlr4::ParserRuleContext *, LoopPlan> loops;
+    std::unordered_map<const antlr4::ParserRuleContext *, BlockPlan> blocks;
+    std::unordered_map<const antlr4::ParserRuleContext *, std::string> strings;
+};
+
+// The invariants of `loop` that can be reused in `env`: every function they
+// call (transitively) must exist, assign no globals and print nothing, and
+// nothing they read may be written by the loop or by anything it calls.
+// Appended to `out`.
+void selectInvariants(const LoopPlan &loop, const Environment &env,
+                      std::vector<const antlr4::ParserRuleContext *> &out);
+
+// The repeats of `block` that can be reused in `env`: those with no calls in
+// between, or whose calls (transitively) assign nothing the repeat reads.
+void selectRepeats(const BlockPlan &block, const Environment &env,
+                   std::vector<const BlockPlan::Repeat *> &out);
+
+// What `body` does outside its own scope, for Function::effects.
+FunctionEffects analyzeFunction(const std::vector<std::string> &parameterNames,
+                                CParser::CompoundStatementContext *body);
+
+// Function::effects of a host function: it may change state outside the
+// interpreter, so calls to it are never hoisted out of loops.
+FunctionEffects hostFunctionEffects();
+
+// How `body` can run in place of a call, for Function::inlineBody; nullopt if
+// it is too big, branches, loops or opens blocks, does not end in a return, or
+// declares a name twice (parameters included), since an inlined call puts
+// parameters and locals in one scope instead of two.
+std::optional<InlineBody> analyzeInline(const std::vector<std::string> &parameterNames,
+                                        CParser::CompoundStatementContext *body);
+
+#endif // OPTIMIZER_H
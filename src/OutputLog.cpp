@@ -0,0 +1,52 @@
+// OutputLog.cpp
+#include "OutputLog.h"
+
+#include <algorithm>
+
+OutputLog::OutputLog(size_t maxLines) : maxLines(std::max<size_t>(maxLines, 1)) {}
+
+void OutputLog::append(std::string_view more) {
+    size_t base = text.size();
+    text.append(more);
+    for (size_t pos = more.find('\n'); pos != std::string_view::npos; pos = more.find('\n', pos + 1)) {
+        starts.push_back(base + pos + 1);
+    }
+    dropOldLines();
+}
+
+void OutputLog::clear() {
+    text.clear();
+    starts.assign(1, 0);
+    first = 0;
+}
+
+size_t OutputLog::lineCount() const {
+    size_t complete = starts.size() - 1 - first;
+    return starts.back() == text.size() ? complete : complete + 1;
+}
+
+std::string_view OutputLog::line(size_t index) const {
+    size_t at = first + index;
+    size_t begin = starts[at];
+    size_t end = at + 1 < starts.size() ? starts[at + 1] - 1 : text.size();
+    return std::string_view(text).substr(begin, end - begin);
+}
+
+void OutputLog::dropOldLines() {
+    size_t count = lineCount();
+    if (count > maxLines) {
+        dropped += count - maxLines;
+        first += count - maxLines;
+    }
+    // Compact once the dropped prefix outweighs what is kept.
+    if (first == 0 || first < starts.size() - first) {
+        return;
+    }
+    size_t shift = starts[first];
+    text.erase(0, shift);
+    starts.erase(starts.begin(), starts.begin() + static_cast<std::ptrdiff_t>(first));
+    for (size_t &start : starts) {
+        start -= shift;
+    }
+    first = 0;
+}
@@ -0,0 +1,49 @@
+// OutputLog.h
+#ifndef OUTPUT_LOG_H
+#define OUTPUT_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Append-only text split into lines, keeping only the most recent maxLines.
+// All text lives in one buffer with a start offset per line, so a line can be
+// fetched by index in O(1) and drawn on its own (see ImGuiListClipper) rather
+// than laying out the whole history every frame. Dropped lines are reclaimed
+// in bulk once they make up half the buffer, so appending stays amortised
+// O(length) and memory stays bounded.
+class OutputLog {
+public:
+    static constexpr size_t kDefaultMaxLines = 100000;
+
+    explicit OutputLog(size_t maxLines = kDefaultMaxLines);
+
+    // Appends text; every '\n' ends a line. Text after the last '\n' is an
+    // unfinished line that later appends continue.
+    void append(std::string_view text);
+    void clear();
+
+    // Lines currently held, oldest first, including an unfinished last line.
+    size_t lineCount() const;
+    // Line `index` (0 = oldest held) without its newline. Valid until the
+    // next append() or clear().
+    std::string_view line(size_t index) const;
+
+    // Lines dropped so far to stay within maxLines.
+    uint64_t droppedLines() const { return dropped; }
+
+private:
+    void dropOldLines();
+
+    size_t maxLines;
+    std::string text;
+    // Start of every line in `text` from `first` on; the last entry is the
+    // start of the unfinished line (== text.size() if it is empty).
+    std::vector<size_t> starts{0};
+    size_t first = 0;
+    uint64_t dropped = 0;
+};
+
+#endif // OUTPUT_LOG_H
@@ -0,0 +1,53 @@
+#include "OutputSink.h"
+
+#include "Utils.h"
+
+namespace {
+
+// Longest text appendAnyString produces: a number (see NumberText).
+constexpr size_t kMaxValueLength = std::tuple_size_v<NumberText>;
+
+} // namespace
+
+OutputSink::OutputSink(std::ostream &out, size_t capacity) : out(out), capacity(capacity) {
+    buffer.reserve(capacity);
+}
+
+OutputSink::~OutputSink() {
+    flush();
+}
+
+void OutputSink::write(std::string_view text) {
+    reserveFor(text.size());
+    if (text.size() > capacity) {
+        // Larger than the whole buffer: pass it straight through.
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return;
+    }
+    buffer.append(text);
+}
+
+void OutputSink::put(char c) {
+    reserveFor(1);
+    buffer.push_back(c);
+}
+
+void OutputSink::writeValue(const std::any &value) {
+    reserveFor(kMaxValueLength);
+    appendAnyString(buffer, value);
+}
+
+void OutputSink::flush() {
+    if (!buffer.empty()) {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+    out.flush();
+}
+
+void OutputSink::reserveFor(size_t bytes) {
+    if (buffer.size() + bytes > capacity && !buffer.empty()) {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+}
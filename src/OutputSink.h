@@ -0,0 +1,42 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <any>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Collects output in one large buffer and hands it to the stream in a single
+// write when the buffer fills, on flush(), or on destruction. Memory use is
+// bounded by the capacity, however much is written.
+class OutputSink {
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
+    explicit OutputSink(std::ostream &out, size_t capacity = kDefaultCapacity);
+    ~OutputSink();
+
+    OutputSink(const OutputSink &) = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+
+    void write(std::string_view text);
+    void put(char c);
+    // A result as anyToString would print it.
+    void writeValue(const std::any &value);
+
+    // Writes the buffered output to the stream and flushes the stream.
+    void flush();
+
+    size_t buffered() const { return buffer.size(); }
+
+private:
+    // Makes room for `bytes` more, writing out what is buffered if needed.
+    void reserveFor(size_t bytes);
+
+    std::ostream &out;
+    std::string buffer;
+    size_t capacity;
+};
+
+#endif // OUTPUT_SINK_H
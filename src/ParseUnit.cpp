@@ -0,0 +1,98 @@
+#include "ParseUnit.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+uint64_t newInputId() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+ParseUnit::ParseUnit(std::string_view code, size_t lineOffset)
+    : errorListener(lineOffset),
+      input(code),
+      lexer(&input),
+      tokens(&lexer),
+      parser(&tokens),
+      inputId(newInputId()) {
+    parser.removeErrorListeners();
+    parser.addErrorListener(&errorListener);
+}
+
+void ParseUnit::reset(std::string_view code) {
+    input.load(code.data(), code.size(), false);
+    lexer.setInputStream(&input);
+    tokens.setTokenSource(&lexer);
+    parser.setTokenStream(&tokens);
+    root = nullptr;
+    plan.reset();
+    inputId = newInputId();
+}
+
+void ParseUnit::setRoot(antlr4::ParserRuleContext *ctx) {
+    root = ctx;
+    plan = std::make_unique<OptimizationPlan>(ctx);
+}
+
+void ParseUnit::lex() {
+    tokens.fill();
+}
+
+CParser::TranslationUnitContext *ParseUnit::parseTranslationUnit() {
+    auto *ctx = parser.translationUnit();
+    setRoot(ctx);
+    return ctx;
+}
+
+CParser::ReplInputContext *ParseUnit::parseReplInput() {
+    auto *ctx = parser.replInput();
+    setRoot(ctx);
+    return ctx;
+}
+
+CParser::CompoundStatementContext *ParseUnit::parseCompoundStatement() {
+    auto *ctx = parser.compoundStatement();
+    setRoot(ctx);
+    return ctx;
+}
+
+std::string ParseUnit::textOf(antlr4::ParserRuleContext *ctx) {
+    antlr4::misc::Interval interval(ctx->getStart()->getStartIndex(), ctx->getStop()->getStopIndex());
+    return input.getText(interval);
+}
+
+namespace {
+
+void analyzeBody(FunctionBody &body, const std::vector<std::string> &parameterNames) {
+    body.effects = analyzeFunction(parameterNames, body.tree);
+    body.inlineBody = analyzeInline(parameterNames, body.tree);
+}
+
+} // namespace
+
+std::shared_ptr<const Function> compileFunction(Function func) {
+    if (func.parsed.tree) {
+        analyzeBody(func.parsed, func.parameterNames);
+    } else {
+        func.deferred = std::make_shared<Function::DeferredBody>();
+    }
+    return std::make_shared<const Function>(std::move(func));
+}
+
+const FunctionBody &Function::compiled() const {
+    if (!deferred) {
+        return parsed;
+    }
+    // Isolates share functions, so two threads may get here at once.
+    std::call_once(deferred->once, [this] {
+        FunctionBody &body = deferred->body;
+        body.unit = std::make_shared<ParseUnit>(bodyText);
+        body.tree = body.unit->parseCompoundStatement();
+        analyzeBody(body, parameterNames);
+    });
+    return deferred->body;
+}
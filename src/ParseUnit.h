@@ -0,0 +1,74 @@
+#ifndef PARSE_UNIT_H
+#define PARSE_UNIT_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include "antlr4-runtime.h"
+#include "CLexer.h"
+#include "CParser.h"
+#include "CustomErrorListener.h"
+#include "Function.h"
+#include "Optimizer.h"
+
+// Owns everything ANTLR needs to keep a parse tree alive: the character stream,
+// lexer, token stream and parser. Contexts returned by the parse methods stay
+// valid for as long as the unit does, so functions can hold on to their parsed
+// body (via a shared_ptr to the unit) instead of re-parsing it on every call.
+class ParseUnit {
+public:
+    // lineOffset is added to the line numbers of reported syntax errors, for
+    // units that hold a slice of a larger source buffer.
+    explicit ParseUnit(std::string_view code, size_t lineOffset = 0);
+
+    ParseUnit(const ParseUnit &) = delete;
+    ParseUnit &operator=(const ParseUnit &) = delete;
+
+    // Starts over on new input, keeping the lexer, token stream and parser
+    // (and the buffers they have grown). Destroys the previous tree, so only
+    // call it when nothing points into that tree any more.
+    void reset(std::string_view code);
+
+    // Tokenises the whole input up front. Optional: parsing pulls tokens
+    // from the lexer on demand otherwise.
+    void lex();
+
+    CParser::TranslationUnitContext *parseTranslationUnit();
+    CParser::ReplInputContext *parseReplInput();
+    CParser::CompoundStatementContext *parseCompoundStatement();
+
+    // Root of the most recent parse (nullptr before any parse).
+    antlr4::ParserRuleContext *tree() const { return root; }
+    antlr4::CommonTokenStream *tokenStream() { return &tokens; }
+
+    // The optimizer's analyses of tree(), built right after it was parsed.
+    const OptimizationPlan *optimizationPlan() const { return plan.get(); }
+
+    // Identifies the current input among all units' inputs, past and present
+    // (reset() gets a new one), e.g. to tell apart line numbers that belong
+    // to different sources.
+    uint64_t id() const { return inputId; }
+
+    // Exact source text of a context parsed by this unit.
+    std::string textOf(antlr4::ParserRuleContext *ctx);
+
+private:
+    void setRoot(antlr4::ParserRuleContext *ctx);
+
+    CustomErrorListener errorListener;
+    antlr4::ANTLRInputStream input;
+    CLexer lexer;
+    antlr4::CommonTokenStream tokens;
+    CParser parser;
+    antlr4::ParserRuleContext *root = nullptr;
+    std::unique_ptr<OptimizationPlan> plan;
+    uint64_t inputId;
+};
+
+// Freezes func for registration in an Environment: analyses its tree, or for a
+// function defined without one (e.g. loaded from the program cache), defers
+// parsing bodyText to the first Function::compiled(). Either way the result
+// can be shared between threads.
+std::shared_ptr<const Function> compileFunction(Function func);
+
+#endif // PARSE_UNIT_H
@@ -0,0 +1,151 @@
+// PerfCounters.cpp
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+constexpr std::array<uint64_t, PerfCounters::CounterCount> kConfigs = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES,
+};
+
+int openCounter(uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    // User space only: allowed at the default perf_event_paranoid level, and
+    // the interpreter's own work is what we want to see.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // This thread, any CPU.
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    fds.fill(-1);
+#ifdef __linux__
+    for (int i = 0; i < CounterCount; ++i) {
+        fds[i] = openCounter(kConfigs[i]);
+        if (fds[i] < 0 && reason.empty()) {
+            int error = errno;
+            reason = std::string("perf_event_open: ") + std::strerror(error);
+            if (error == EACCES || error == EPERM) {
+                reason += " (check /proc/sys/kernel/perf_event_paranoid)";
+            } else if (error == ENOENT || error == EOPNOTSUPP) {
+                reason += " (no hardware counters here, e.g. in a VM)";
+            }
+        }
+    }
+#else
+    reason = "hardware counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::available() const {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+PerfCounters::Sample PerfCounters::stop() {
+    Sample sample;
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < CounterCount; ++i) {
+        // value, time enabled, time running
+        uint64_t data[3] = {};
+        if (fds[i] < 0 || read(fds[i], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        if (data[2] == 0) {
+            // Never scheduled onto the PMU; a count of 0 would be a lie.
+            continue;
+        }
+        double scale = data[2] < data[1] ? static_cast<double>(data[1]) / static_cast<double>(data[2]) : 1.0;
+        sample.values[i] = static_cast<uint64_t>(static_cast<double>(data[0]) * scale);
+    }
+#endif
+    return sample;
+}
+
+std::optional<double> PerfCounters::Sample::ipc() const {
+    const auto &cycles = values[Cycles];
+    const auto &instructions = values[Instructions];
+    if (!cycles || !instructions || *cycles == 0) {
+        return std::nullopt;
+    }
+    return static_cast<double>(*instructions) / static_cast<double>(*cycles);
+}
+
+const char *PerfCounters::counterName(Counter counter) {
+    switch (counter) {
+        case Cycles:       return "cycles";
+        case Instructions: return "instructions";
+        case BranchMisses: return "branch-misses";
+        case CacheMisses:  return "cache-misses";
+        default:           return "?";
+    }
+}
+
+void writePerfSample(std::ostream &out, const PerfSample &sample) {
+    for (int i = 0; i < PerfCounters::CounterCount; ++i) {
+        auto counter = static_cast<PerfCounters::Counter>(i);
+        out << "[perf] " << PerfCounters::counterName(counter) << ": ";
+        if (sample[counter]) {
+            out << *sample[counter];
+        } else {
+            out << "n/a";
+        }
+        out << '\n';
+    }
+    if (auto ipc = sample.ipc()) {
+        out << "[perf] IPC: " << *ipc << '\n';
+    }
+}
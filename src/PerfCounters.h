@@ -0,0 +1,61 @@
+// PerfCounters.h
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+
+// Hardware performance counters for the calling thread, read through Linux
+// perf_event_open: cycles, instructions, branch misses and cache misses.
+// Counters the kernel won't give us (no PMU in a VM, perf_event_paranoid too
+// strict, not Linux) are simply missing from the sample, so callers can wrap
+// any evaluation or benchmark unconditionally.
+//
+//   PerfCounters counters;
+//   counters.start();
+//   interpreter.evaluate(code, true);
+//   PerfSample sample = counters.stop();
+class PerfCounters {
+public:
+    enum Counter { Cycles, Instructions, BranchMisses, CacheMisses, CounterCount };
+
+    struct Sample {
+        std::array<std::optional<uint64_t>, CounterCount> values;
+
+        const std::optional<uint64_t> &operator[](Counter counter) const { return values[counter]; }
+        // Instructions per cycle, if both were counted.
+        std::optional<double> ipc() const;
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // True if at least one counter could be opened.
+    bool available() const;
+    // Why the missing counters are missing (empty if all are available).
+    const std::string &unavailableReason() const { return reason; }
+
+    // Zeroes and enables the counters.
+    void start();
+    // Disables the counters and reads them. Values are scaled up if the
+    // kernel had to multiplex the counters.
+    Sample stop();
+
+    static const char *counterName(Counter counter);
+
+private:
+    std::array<int, CounterCount> fds;
+    std::string reason;
+};
+
+using PerfSample = PerfCounters::Sample;
+
+// One line per counter ("cycles: 123456" or "cycles: n/a"), plus IPC.
+void writePerfSample(std::ostream &out, const PerfSample &sample);
+
+#endif // PERF_COUNTERS_H
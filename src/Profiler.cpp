@@ -0,0 +1,96 @@
+// Profiler.cpp
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+
+void Profiler::enter(const std::string &function) {
+    auto [it, inserted] = stats.try_emplace(function);
+    ++it->second.calls;
+    ++activeDepth[function];
+
+    size_t pathLength = path.size();
+    if (!path.empty()) {
+        path += ';';
+    }
+    path += function;
+    stack.push_back({&it->second, &it->first, pathLength, Clock::now()});
+}
+
+void Profiler::exit() {
+    if (stack.empty()) {
+        return;
+    }
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    auto elapsed = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count());
+    uint64_t self = elapsed > frame.childNs ? elapsed - frame.childNs : 0;
+    frame.stats->exclusiveNs += self;
+    if (--activeDepth[*frame.name] == 0) {
+        frame.stats->inclusiveNs += elapsed;
+    }
+    folded[path] += self;
+    path.resize(frame.pathLength);
+
+    if (!stack.empty()) {
+        stack.back().childNs += elapsed;
+    }
+}
+
+void Profiler::writeFolded(std::ostream &out) const {
+    std::vector<std::pair<std::string, uint64_t>> rows(folded.begin(), folded.end());
+    std::sort(rows.begin(), rows.end());
+    for (const auto &[stackPath, ns] : rows) {
+        out << stackPath << ' ' << ns << '\n';
+    }
+}
+
+void Profiler::writeSummary(std::ostream &out, size_t topLines) const {
+    std::vector<std::pair<std::string, FunctionStats>> rows(stats.begin(), stats.end());
+    std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+        return a.second.exclusiveNs > b.second.exclusiveNs;
+    });
+
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    out << std::left << std::setw(24) << "function" << std::right
+        << std::setw(12) << "calls" << std::setw(14) << "incl ms" << std::setw(14) << "excl ms" << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (const auto &[name, s] : rows) {
+        out << std::left << std::setw(24) << name << std::right
+            << std::setw(12) << s.calls << std::setw(14) << ms(s.inclusiveNs)
+            << std::setw(14) << ms(s.exclusiveNs) << '\n';
+    }
+
+    std::vector<std::pair<SourceLine, uint64_t>> hot(lineHits.begin(), lineHits.end());
+    std::sort(hot.begin(), hot.end(), [](const auto &a, const auto &b) {
+        if (a.second != b.second) {
+            return a.second > b.second;
+        }
+        return a.first.source != b.first.source ? a.first.source < b.first.source : a.first.line < b.first.line;
+    });
+    if (hot.size() > topLines) {
+        hot.resize(topLines);
+    }
+    out << "\n" << std::left << std::setw(10) << "src:line" << std::right << std::setw(12) << "hits" << '\n';
+    for (const auto &[at, hits] : hot) {
+        std::string where = std::to_string(at.source) + ":" + std::to_string(at.line);
+        out << std::left << std::setw(10) << where << std::right << std::setw(12) << hits << '\n';
+    }
+    out << std::defaultfloat;
+}
+
+void Profiler::reset() {
+    stats.clear();
+    activeDepth.clear();
+    lineHits.clear();
+    sources.clear();
+    lastUnitId = 0;
+    lastSource = 0;
+    folded.clear();
+    stack.clear();
+    path.clear();
+}
@@ -0,0 +1,104 @@
+// Profiler.h
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Opt-in instrumenting profiler (Interpreter::enableProfiling). The visitor
+// reports every interpreted call and every executed statement; the profiler
+// keeps per-function call counts, inclusive and exclusive time, per-line hit
+// counts, and exclusive time per call stack for flamegraphs. When profiling is
+// off the visitor holds a null Profiler* and skips all of this.
+class Profiler {
+public:
+    struct FunctionStats {
+        uint64_t calls = 0;
+        uint64_t inclusiveNs = 0; // recursive calls are only counted once
+        uint64_t exclusiveNs = 0;
+    };
+
+    // Times one call for its lifetime. A null profiler is a no-op.
+    class CallScope {
+    public:
+        CallScope(Profiler *profiler, const std::string &function) : profiler(profiler) {
+            if (profiler) {
+                profiler->enter(function);
+            }
+        }
+        ~CallScope() {
+            if (profiler) {
+                profiler->exit();
+            }
+        }
+        CallScope(const CallScope &) = delete;
+        CallScope &operator=(const CallScope &) = delete;
+
+    private:
+        Profiler *profiler;
+    };
+
+    // A line of one source: sources are numbered 1, 2, ... in the order
+    // their first line was hit. Each file, REPL input and separately parsed
+    // function body is its own source.
+    struct SourceLine {
+        size_t source;
+        size_t line;
+        bool operator==(const SourceLine &) const = default;
+    };
+    struct SourceLineHash {
+        size_t operator()(const SourceLine &l) const { return l.source * 1000003u ^ l.line; }
+    };
+
+    // One statement (or local declaration) executed on `line` of the parse
+    // unit input `unitId` (see ParseUnit::id()).
+    void hitLine(uint64_t unitId, size_t line) {
+        if (unitId != lastUnitId) {
+            lastUnitId = unitId;
+            lastSource = sources.try_emplace(unitId, sources.size() + 1).first->second;
+        }
+        ++lineHits[{lastSource, line}];
+    }
+
+    const std::unordered_map<std::string, FunctionStats> &functions() const { return stats; }
+    const std::unordered_map<SourceLine, uint64_t, SourceLineHash> &lines() const { return lineHits; }
+
+    // Folded stacks ("main;fib;fib 1234", exclusive nanoseconds per stack),
+    // the input format of flamegraph.pl, inferno and speedscope.
+    void writeFolded(std::ostream &out) const;
+
+    // Functions by exclusive time, then the most executed source lines.
+    void writeSummary(std::ostream &out, size_t topLines = 10) const;
+
+    void reset();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        FunctionStats *stats;
+        const std::string *name;
+        size_t pathLength;   // length of `path` before this frame was pushed
+        Clock::time_point start;
+        uint64_t childNs = 0;
+    };
+
+    void enter(const std::string &function);
+    void exit();
+
+    std::unordered_map<std::string, FunctionStats> stats;
+    std::unordered_map<std::string, unsigned> activeDepth; // for recursion
+    std::unordered_map<SourceLine, uint64_t, SourceLineHash> lineHits;
+    std::unordered_map<uint64_t, size_t> sources; // ParseUnit::id() -> source number
+    uint64_t lastUnitId = 0;                      // no unit has id 0
+    size_t lastSource = 0;
+    std::unordered_map<std::string, uint64_t> folded;
+    std::vector<Frame> stack;
+    std::string path; // "main;fib;fib" for the current stack
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,26 @@
+#include "Program.h"
+
+#include "CInterpreterVisitor.h"
+#include "Environment.h"
+
+std::shared_ptr<const Program> Program::compile(std::string_view source) {
+    std::shared_ptr<Program> program(new Program());
+    program->unit = std::make_shared<ParseUnit>(source);
+    auto *tree = program->unit->parseTranslationUnit();
+
+    // Function definitions are registered into a scratch environment by the
+    // visitor as usual, then lifted out; globals are only recorded, since
+    // their values belong to each isolate.
+    Environment scratch;
+    CInterpreterVisitor visitor(&scratch, program->unit);
+    for (auto *decl : tree->externalDeclaration()) {
+        if (auto *fn = decl->functionDefinition()) {
+            visitor.visit(fn);
+            std::string name = fn->IDENTIFIER()->getText();
+            program->compiledFunctions.emplace_back(name, scratch.getFunctionShared(name));
+        } else {
+            program->globalDeclarations.push_back(decl->declaration());
+        }
+    }
+    return program;
+}
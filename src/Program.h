@@ -0,0 +1,40 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Function.h"
+#include "ParseUnit.h"
+
+// A file-mode program compiled once and shared, read-only, by any number of
+// Interpreter isolates. Parsing and function registration happen here; each
+// isolate then runs the global declarations against its own environment, so
+// isolates share code but never state.
+class Program {
+public:
+    // Parses `source` as a translation unit. Throws std::runtime_error on
+    // syntax errors or invalid function definitions.
+    static std::shared_ptr<const Program> compile(std::string_view source);
+
+    const std::vector<std::pair<std::string, std::shared_ptr<const Function>>> &functions() const {
+        return compiledFunctions;
+    }
+
+    // Global declarations in source order.
+    const std::vector<CParser::DeclarationContext *> &globals() const { return globalDeclarations; }
+
+    const std::shared_ptr<ParseUnit> &parseUnit() const { return unit; }
+
+private:
+    Program() = default;
+
+    std::shared_ptr<ParseUnit> unit;
+    std::vector<std::pair<std::string, std::shared_ptr<const Function>>> compiledFunctions;
+    std::vector<CParser::DeclarationContext *> globalDeclarations;
+};
+
+#endif // PROGRAM_H
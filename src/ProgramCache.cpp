@@ -0,0 +1,264 @@
+#include "ProgramCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "MappedFile.h"
+
+namespace {
+
+// Bump kFormatVersion whenever the layout below changes, and
+// kInterpreterVersion whenever cached declarations would run differently.
+constexpr char kMagic[4] = {'V', 'C', 'I', 'C'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr std::string_view kInterpreterVersion = "VersatileCInterpreter-1";
+
+// Layout: magic, format version, source hash, source length, payload length,
+// payload checksum, then the payload (declarations followed by a copy of the
+// source, which is compared on load so a hash collision can't return the
+// wrong program).
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint64_t sourceHash;
+    uint64_t sourceLength;
+    uint64_t payloadLength;
+    uint64_t payloadChecksum;
+};
+
+// Numbers the temporaries of one process, so isolates storing the same entry
+// at the same time each write their own.
+std::atomic<uint64_t> nextTemporary{0};
+
+uint64_t fnv1a(std::string_view data, uint64_t h = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+class Writer {
+public:
+    template<typename T>
+    void pod(const T &value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    void str(std::string_view s) {
+        pod(static_cast<uint32_t>(s.size()));
+        out.append(s);
+    }
+    void value(const VarValue &v) {
+        pod(static_cast<uint8_t>(v.index()));
+        std::visit([this](auto x) { pod(x); }, v);
+    }
+    std::string out;
+};
+
+// Bounds-checked reader over the mapped payload; any overrun means the entry
+// is corrupt.
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data(data) {}
+
+    template<typename T>
+    T pod() {
+        need(sizeof(T));
+        T value;
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    std::string_view str() {
+        auto len = pod<uint32_t>();
+        need(len);
+        std::string_view s = data.substr(pos, len);
+        pos += len;
+        return s;
+    }
+    VarType type() {
+        auto t = pod<uint8_t>();
+        if (t > static_cast<uint8_t>(VarType::CHAR)) {
+            throw std::runtime_error("bad type");
+        }
+        return static_cast<VarType>(t);
+    }
+    VarValue value() {
+        switch (pod<uint8_t>()) {
+            case 0: return pod<int>();
+            case 1: return pod<double>();
+            case 2: return pod<char>();
+        }
+        throw std::runtime_error("bad value");
+    }
+    bool done() const { return pos == data.size(); }
+
+private:
+    void need(size_t n) const {
+        if (n > data.size() - pos) {
+            throw std::runtime_error("truncated");
+        }
+    }
+    std::string_view data;
+    size_t pos = 0;
+};
+
+std::string serialize(std::string_view source, const CachedProgram &program) {
+    Writer w;
+    w.pod(static_cast<uint32_t>(program.declarations.size()));
+    for (const auto &decl : program.declarations) {
+        w.pod(static_cast<uint8_t>(decl.kind));
+        switch (decl.kind) {
+            case CachedDeclaration::Kind::Function: {
+                const Function &f = decl.function;
+                w.str(decl.name);
+                w.pod(static_cast<uint8_t>(f.returnType));
+                w.pod(static_cast<uint32_t>(f.parameterNames.size()));
+                for (size_t i = 0; i < f.parameterNames.size(); ++i) {
+                    w.pod(static_cast<uint8_t>(f.parameterTypes[i]));
+                    w.str(f.parameterNames[i]);
+                }
+                w.str(f.bodyText);
+                break;
+            }
+            case CachedDeclaration::Kind::GlobalValue:
+                w.str(decl.name);
+                w.pod(static_cast<uint8_t>(decl.value.type));
+                w.value(decl.value.value);
+                break;
+            case CachedDeclaration::Kind::GlobalSource:
+                w.str(decl.source);
+                break;
+        }
+    }
+    w.out.append(source);
+    return std::move(w.out);
+}
+
+CachedProgram deserialize(std::string_view payload) {
+    Reader r(payload);
+    CachedProgram program;
+    auto count = r.pod<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+        CachedDeclaration decl;
+        switch (r.pod<uint8_t>()) {
+            case static_cast<uint8_t>(CachedDeclaration::Kind::Function): {
+                decl.kind = CachedDeclaration::Kind::Function;
+                decl.name = r.str();
+                decl.function.returnType = r.type();
+                auto params = r.pod<uint32_t>();
+                for (uint32_t p = 0; p < params; ++p) {
+                    decl.function.parameterTypes.push_back(r.type());
+                    decl.function.parameterNames.emplace_back(r.str());
+                }
+                decl.function.bodyText = r.str();
+                break;
+            }
+            case static_cast<uint8_t>(CachedDeclaration::Kind::GlobalValue):
+                decl.kind = CachedDeclaration::Kind::GlobalValue;
+                decl.name = r.str();
+                decl.value.type = r.type();
+                decl.value.value = r.value();
+                break;
+            case static_cast<uint8_t>(CachedDeclaration::Kind::GlobalSource):
+                decl.kind = CachedDeclaration::Kind::GlobalSource;
+                decl.source = r.str();
+                break;
+            default:
+                throw std::runtime_error("bad declaration kind");
+        }
+        program.declarations.push_back(std::move(decl));
+    }
+    if (!r.done()) {
+        throw std::runtime_error("trailing bytes");
+    }
+    return program;
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(std::string directory)
+    : directory(std::move(directory)) {}
+
+uint64_t ProgramCache::hash(std::string_view source) {
+    return fnv1a(source, fnv1a(kInterpreterVersion));
+}
+
+std::string ProgramCache::entryPath(std::string_view source) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.vcic", static_cast<unsigned long long>(hash(source)));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+std::optional<CachedProgram> ProgramCache::load(std::string_view source) const {
+    try {
+        MappedFile file(entryPath(source));
+        std::string_view bytes = file.view();
+
+        Header header{};
+        if (bytes.size() < sizeof(Header)) {
+            return std::nullopt;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(Header));
+        std::string_view payload = bytes.substr(sizeof(Header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+            header.formatVersion != kFormatVersion ||
+            header.sourceHash != hash(source) ||
+            header.sourceLength != source.size() ||
+            header.payloadLength != payload.size() ||
+            header.payloadChecksum != fnv1a(payload) ||
+            payload.size() < source.size() ||
+            payload.substr(payload.size() - source.size()) != source) {
+            return std::nullopt;
+        }
+        return deserialize(payload.substr(0, payload.size() - source.size()));
+    } catch (const std::exception &) {
+        // Missing, unreadable or corrupt: all the same to the caller.
+        return std::nullopt;
+    }
+}
+
+void ProgramCache::store(std::string_view source, const CachedProgram &program) const {
+    std::string payload = serialize(source, program);
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.formatVersion = kFormatVersion;
+    header.sourceHash = hash(source);
+    header.sourceLength = source.size();
+    header.payloadLength = payload.size();
+    header.payloadChecksum = fnv1a(payload);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    // Write to a private temporary and rename it into place, so a reader never
+    // sees a half-written entry.
+    std::string path = entryPath(source);
+    std::string tmp = path + ".tmp" + std::to_string(::getpid()) + "-" +
+                      std::to_string(nextTemporary.fetch_add(1, std::memory_order_relaxed));
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+    }
+}
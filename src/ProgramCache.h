@@ -0,0 +1,55 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Function.h"
+#include "Variable.h"
+
+// One top-level declaration of a cached program, kept in source order.
+struct CachedDeclaration {
+    enum class Kind : uint8_t {
+        Function,       // signature + body text; the body is parsed on load
+        GlobalValue,    // global with a constant (or no) initialiser
+        GlobalSource    // any other global; its declaration is re-evaluated on load
+    };
+
+    Kind kind = Kind::Function;
+    std::string name;
+    Function function;
+    Variable value{VarType::INT, 0};
+    std::string source;
+};
+
+struct CachedProgram {
+    std::vector<CachedDeclaration> declarations;
+};
+
+// On-disk cache of file-mode programs. An entry is keyed by a hash of the
+// source text and the interpreter version, and holds the program's declaration
+// index so a later run can register everything without parsing the whole file.
+// Entries are read through mmap and fully validated; a corrupt, truncated or
+// stale entry is treated as a miss and gets overwritten by the next store().
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string directory);
+
+    std::optional<CachedProgram> load(std::string_view source) const;
+
+    // Best effort: if the entry can't be written the next run just misses again.
+    void store(std::string_view source, const CachedProgram &program) const;
+
+    std::string entryPath(std::string_view source) const;
+
+    // 64-bit FNV-1a over the interpreter version and the source.
+    static uint64_t hash(std::string_view source);
+
+private:
+    std::string directory;
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,59 @@
+#include "ProgramOutput.h"
+
+#include "Utils.h"
+
+#include <algorithm>
+#include <charconv>
+
+ProgramOutput::~ProgramOutput() {
+    flush();
+}
+
+void ProgramOutput::write(std::string_view text) {
+    total += text.size();
+    if (threshold == 0 && target) {
+        target(text);
+        return;
+    }
+    if (!target && buffer.size() + text.size() > bufferLimit) {
+        size_t room = bufferLimit - std::min(bufferLimit, buffer.size());
+        dropped += text.size() - room;
+        text = text.substr(0, room);
+    }
+    buffer.append(text);
+    flushIfFull();
+}
+
+void ProgramOutput::put(char c) {
+    write(std::string_view(&c, 1));
+}
+
+void ProgramOutput::writeInt(int value) {
+    NumberText digits;
+    write(formatNumber(digits, value));
+}
+
+void ProgramOutput::writeDouble(double value) {
+    NumberText digits;
+    write(formatNumber(digits, value));
+}
+
+void ProgramOutput::setFlushTarget(FlushTarget newTarget, size_t newThreshold) {
+    flush();
+    target = std::move(newTarget);
+    threshold = newThreshold;
+}
+
+void ProgramOutput::flush() {
+    if (target) {
+        drain(target);
+    }
+}
+
+std::string_view ProgramOutput::droppedNote(NoteText &text) const {
+    constexpr std::string_view before = "\n[", after = " more bytes of output dropped]\n";
+    char *end = std::copy(before.begin(), before.end(), text.data());
+    end = std::to_chars(end, text.data() + text.size(), dropped).ptr;
+    end = std::copy(after.begin(), after.end(), end);
+    return {text.data(), static_cast<size_t>(end - text.data())};
+}
@@ -0,0 +1,95 @@
+// ProgramOutput.h
+#ifndef PROGRAM_OUTPUT_H
+#define PROGRAM_OUTPUT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// What a program prints with printf, putchar and puts. Each interpreter has
+// one, and its front end drains it: the REPL after every line, the GUI into its
+// output log, the CLI straight to stdout. Everything is appended to one buffer
+// that keeps its capacity when drained, and numbers are formatted with
+// std::to_chars on the stack, so printing allocates nothing once the buffer
+// has grown.
+//
+// With a flush target (see setFlushTarget) the buffer is handed over whenever
+// it reaches the threshold, or bypassed altogether, so a program printing
+// millions of lines runs in bounded memory. Without one it holds up to a
+// limit (see setBufferLimit) until drained, and drops the rest.
+class ProgramOutput {
+public:
+    static constexpr size_t kDefaultFlushThreshold = 1 << 16;
+    static constexpr size_t kDefaultBufferLimit = 1 << 20;
+    using FlushTarget = std::function<void(std::string_view)>;
+
+    ProgramOutput() = default;
+    ~ProgramOutput(); // flush()
+
+    ProgramOutput(const ProgramOutput &) = delete;
+    ProgramOutput &operator=(const ProgramOutput &) = delete;
+
+    void write(std::string_view text);
+    void put(char c);
+    void writeInt(int value);
+    // Fixed notation with six decimals, like printf's %f.
+    void writeDouble(double value);
+
+    // Bytes written since construction, flushed and drained ones included.
+    uint64_t written() const { return total; }
+
+    // Hands everything buffered to `consume` as one view and empties the
+    // buffer, keeping its capacity. If output was dropped since the last
+    // drain, a second view says how much.
+    template<typename Consume>
+    void drain(Consume &&consume) {
+        if (!buffer.empty()) {
+            consume(std::string_view(buffer));
+            buffer.clear();
+        }
+        if (dropped != 0) {
+            NoteText note;
+            consume(droppedNote(note));
+            dropped = 0;
+        }
+    }
+
+    // Without a flush target, at most `limit` bytes are buffered between
+    // drains and the rest is dropped. Front ends drain after every input, so
+    // this only cuts short one evaluation that prints more than that.
+    void setBufferLimit(size_t limit) { bufferLimit = limit; }
+
+    // Sends `threshold` bytes at a time to `target`, and the rest on flush().
+    // With a threshold of 0 every write goes to `target` as it happens, for a
+    // target that buffers itself. Pass nullptr to go back to buffering until
+    // drained.
+    void setFlushTarget(FlushTarget target, size_t threshold = kDefaultFlushThreshold);
+
+    // Sends everything buffered to the flush target, if there is one.
+    void flush();
+
+    size_t buffered() const { return buffer.size(); }
+
+private:
+    using NoteText = std::array<char, 64>;
+    // "[N more bytes of output dropped]", on a line of its own.
+    std::string_view droppedNote(NoteText &text) const;
+
+    void flushIfFull() {
+        if (buffer.size() >= threshold && target) {
+            flush();
+        }
+    }
+
+    std::string buffer;
+    FlushTarget target;
+    size_t threshold = kDefaultFlushThreshold;
+    size_t bufferLimit = kDefaultBufferLimit;
+    uint64_t total = 0;
+    uint64_t dropped = 0; // since the last drain or flush
+};
+
+#endif // PROGRAM_OUTPUT_H
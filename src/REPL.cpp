@@ -1,13 +1,16 @@
 #include "REPL.h"
+#include <algorithm>
 #include <exception>
 #include <any>
+#include <string_view>
 #include <typeinfo>
+#include <vector>
 
+#include "OutputSink.h"
+#include "Trace.h"
 #include "Utils.h"
 #include "Variable.h"
 
-#define LOG(x) std::clog << x << std::endl;
-
 // Original run() using std::cin and std::cout.
 void REPL::run() {
     run(std::cin, std::cout, false);
@@ -21,27 +24,26 @@ void REPL::run(std::istream &in, std::ostream &out, bool testMode) {
     }
 
     while (std::getline(in, line)) {
-        LOG("[REPL] Read line: '" << line << "'");
+        TRACE(VCI_TRACE_INFO, TraceEvent::ReplLine, static_cast<int64_t>(line.size()));
 
         // Trim whitespace on both ends so that "exit " or " exit" will match.
         auto trimmed = trim(line);
-        LOG("[REPL] Trimmed line: '" << trimmed << "'");
 
         if (trimmed == "exit" || trimmed == "quit") {
-            LOG("[REPL] Exit command detected, breaking loop.");
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplExit);
             break;
         }
         if (trimmed.empty()) {
-            LOG("[REPL] Empty input, skipping.");
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplEmpty);
             if (!testMode) out << "Empty input, please try again.\n\n> ";
             continue;
         }
 
         try {
-            LOG("[REPL] Evaluating: " << trimmed);
             std::any result = interpreter.evaluate(trimmed, false);
+            writeProgramOutput(out);
             std::string outStr = anyToString(result);
-            LOG("[REPL] Result: " << outStr);
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplResult, static_cast<int64_t>(outStr.size()));
 
             if (testMode) {
                 out << outStr;
@@ -49,7 +51,8 @@ void REPL::run(std::istream &in, std::ostream &out, bool testMode) {
                 out << outStr << "\n\n> ";
             }
         } catch (const std::exception &e) {
-            LOG("[REPL] Caught exception: " << e.what());
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplError);
+            writeProgramOutput(out);
             if (testMode) {
                 out << "Error: " << e.what();
             } else {
@@ -57,15 +60,129 @@ void REPL::run(std::istream &in, std::ostream &out, bool testMode) {
             }
         }
     }
-    LOG("[REPL] Exiting run()");
+    TRACE(VCI_TRACE_INFO, TraceEvent::ReplEnd);
+}
+
+namespace {
+
+constexpr size_t kPipeBlockSize = 1 << 16;
+
+// Splits a stream into lines, reading it a block at a time. Views returned by
+// next() stay valid until the following call.
+class BlockLineReader {
+public:
+    explicit BlockLineReader(std::istream &in) : in(in), block(kPipeBlockSize) {}
+
+    bool next(std::string_view &line) {
+        while (true) {
+            auto newline = std::find(block.begin() + begin, block.begin() + end, '\n');
+            if (newline != block.begin() + end) {
+                size_t stop = newline - block.begin();
+                line = std::string_view(block.data() + begin, stop - begin);
+                begin = stop + 1;
+                return true;
+            }
+            if (eof) {
+                // Last line without a trailing newline.
+                if (begin == end) {
+                    return false;
+                }
+                line = std::string_view(block.data() + begin, end - begin);
+                begin = end;
+                return true;
+            }
+            refill();
+        }
+    }
+
+private:
+    // Moves the unfinished line to the front and reads more after it. The
+    // block only grows for a line longer than itself.
+    void refill() {
+        std::copy(block.begin() + begin, block.begin() + end, block.begin());
+        end -= begin;
+        begin = 0;
+        if (end == block.size()) {
+            block.resize(block.size() * 2);
+        }
+        in.read(block.data() + end, static_cast<std::streamsize>(block.size() - end));
+        end += static_cast<size_t>(in.gcount());
+        eof = !in;
+    }
+
+    std::istream &in;
+    std::vector<char> block;
+    size_t begin = 0;
+    size_t end = 0;
+    bool eof = false;
+};
+
+} // namespace
+
+void REPL::runPipe(std::istream &in, std::ostream &out) {
+    BlockLineReader reader(in);
+    OutputSink sink(out);
+    // What the program prints goes straight into the same buffer, ahead of the
+    // line's result.
+    interpreter.output().setFlushTarget([&sink](std::string_view text) { sink.write(text); }, 0);
+    // The target refers to `sink`, so it must go before sink does, however
+    // this function is left.
+    struct TargetGuard {
+        ProgramOutput &output;
+        ~TargetGuard() { output.setFlushTarget(nullptr); }
+    } targetGuard{interpreter.output()};
+    std::string_view line;
+    while (reader.next(line)) {
+        TRACE(VCI_TRACE_INFO, TraceEvent::ReplLine, static_cast<int64_t>(line.size()));
+        std::string_view trimmed = trimView(line);
+
+        if (trimmed == "exit" || trimmed == "quit") {
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplExit);
+            break;
+        }
+        if (trimmed.empty()) {
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplEmpty);
+            continue;
+        }
+        if (trimmed == "flush") {
+            sink.flush();
+            continue;
+        }
+
+        try {
+            std::any result = interpreter.evaluate(trimmed, false);
+            sink.writeValue(result);
+        } catch (const std::exception &e) {
+            TRACE(VCI_TRACE_INFO, TraceEvent::ReplError);
+            sink.write("Error: ");
+            sink.write(e.what());
+        }
+        sink.put('\n');
+    }
+    TRACE(VCI_TRACE_INFO, TraceEvent::ReplEnd);
 }
 
 // Evaluate a single command
 std::string REPL::evaluateCommand(const std::string &input) {
+    std::string text;
     try {
         std::any result = interpreter.evaluate(input, false);
-        return anyToString(result);
+        takeProgramOutput(text);
+        appendAnyString(text, result);
     } catch (const std::exception &e) {
-        return std::string("Error: ") + e.what();
+        takeProgramOutput(text);
+        text += "Error: ";
+        text += e.what();
     }
-}
\ No newline at end of file
+    return text;
+}
+
+void REPL::writeProgramOutput(std::ostream &out) {
+    interpreter.output().drain([&out](std::string_view text) {
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    });
+}
+
+void REPL::takeProgramOutput(std::string &text) {
+    interpreter.output().drain([&text](std::string_view printed) { text += printed; });
+}
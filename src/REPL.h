@@ -13,9 +13,24 @@ public:
     // Overloaded run() method for testing (or use in the IDE) that accepts streams.
     void run(std::istream &in, std::ostream &out, bool testMode);
 
-    // New method that evaluates a single command and returns its result as a string.
+    // Pipe mode, for scripts of statements: reads `in` in large blocks and
+    // evaluates one line at a time, writing each result (or "Error: ...") on
+    // its own line, after anything the line printed. Output is buffered and
+    // written when the buffer fills, on a "flush" line, and at the end. Memory
+    // use doesn't grow with input size.
+    void runPipe(std::istream &in, std::ostream &out);
+
+    // New method that evaluates a single command and returns its result as a string,
+    // after anything the command printed.
     std::string evaluateCommand(const std::string &input);
+
+    // Lets another thread cancel a running command (see ExecutionControl).
+    void setExecutionControl(ExecutionControl *control) { interpreter.setExecutionControl(control); }
 private:
+    // Moves what the program printed (see ProgramOutput) to `out` or `text`.
+    void writeProgramOutput(std::ostream &out);
+    void takeProgramOutput(std::string &text);
+
     Interpreter interpreter; // Instance of Interpreter to evaluate input.
 };
 
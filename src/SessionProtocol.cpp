@@ -0,0 +1,114 @@
+// SessionProtocol.cpp
+#include "SessionProtocol.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace session {
+
+void appendFrame(std::string &out, std::string_view payload) {
+    auto length = static_cast<uint32_t>(payload.size());
+    char header[4] = {static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+                      static_cast<char>(length >> 8), static_cast<char>(length)};
+    out.append(header, sizeof header);
+    out.append(payload);
+}
+
+void appendResponse(std::string &out, Status status, std::string_view text) {
+    auto length = static_cast<uint32_t>(text.size() + 1);
+    char header[5] = {static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+                      static_cast<char>(length >> 8), static_cast<char>(length),
+                      static_cast<char>(status)};
+    out.append(header, sizeof header);
+    out.append(text);
+}
+
+bool nextFrame(std::string_view buffer, std::string_view &payload, size_t &frameSize) {
+    if (buffer.size() < 4) {
+        return false;
+    }
+    uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) {
+        length = (length << 8) | static_cast<unsigned char>(buffer[i]);
+    }
+    if (length > kMaxPayload) {
+        throw std::runtime_error("Message of " + std::to_string(length) + " bytes exceeds the limit");
+    }
+    if (buffer.size() - 4 < length) {
+        return false;
+    }
+    payload = buffer.substr(4, length);
+    frameSize = 4 + static_cast<size_t>(length);
+    return true;
+}
+
+Response parseResponse(std::string_view payload) {
+    if (payload.empty() || (payload[0] != static_cast<char>(Status::Ok) &&
+                            payload[0] != static_cast<char>(Status::Error))) {
+        throw std::runtime_error("Malformed response");
+    }
+    return {static_cast<Status>(payload[0]), std::string(payload.substr(1))};
+}
+
+int connectTo(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof address.sun_path) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Cannot create socket: ") + std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot connect to " + path + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+Client::Client(const std::string &path) : fd(connectTo(path)) {}
+
+Client::~Client() {
+    ::close(fd);
+}
+
+Response request(int fd, std::string_view line, std::string &received) {
+    std::string frame;
+    appendFrame(frame, line);
+    for (size_t sent = 0; sent < frame.size();) {
+        ssize_t n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Cannot send request: ") + std::strerror(errno));
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    std::string_view payload;
+    size_t frameSize = 0;
+    while (!nextFrame(received, payload, frameSize)) {
+        char chunk[4096];
+        ssize_t n = ::recv(fd, chunk, sizeof chunk, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Connection closed by server");
+        }
+        received.append(chunk, static_cast<size_t>(n));
+    }
+    Response response = parseResponse(payload);
+    received.erase(0, frameSize);
+    return response;
+}
+
+} // namespace session
@@ -0,0 +1,66 @@
+// SessionProtocol.h
+#ifndef SESSION_PROTOCOL_H
+#define SESSION_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Wire format of the session server (see SessionServer.h). Every message is a
+// 4-byte big-endian payload length followed by the payload. A request is one
+// REPL line; its response is a status byte followed by what the line printed
+// and then the result text, or the error message. Responses come back in
+// request order, so a client may pipeline requests, and may shut down its
+// sending side after the last one: the server answers them all, then closes.
+namespace session {
+
+constexpr uint32_t kMaxPayload = 1 << 20;
+
+enum class Status : char { Ok = '=', Error = '!' };
+
+struct Response {
+    Status status = Status::Ok;
+    std::string text;
+};
+
+void appendFrame(std::string &out, std::string_view payload);
+void appendResponse(std::string &out, Status status, std::string_view text);
+
+// Finds the first complete frame in `buffer`. Returns false if more bytes
+// are needed; otherwise sets `payload` (a view into buffer) and `frameSize`
+// (bytes to consume). Throws std::runtime_error for a frame over kMaxPayload.
+bool nextFrame(std::string_view buffer, std::string_view &payload, size_t &frameSize);
+
+// Splits a response payload into its status and text. Throws
+// std::runtime_error if it has no valid status byte.
+Response parseResponse(std::string_view payload);
+
+// Connects a blocking stream socket to the server at `path`. Throws
+// std::runtime_error on failure.
+int connectTo(const std::string &path);
+
+// Sends `line` over the blocking socket `fd` and waits for its response.
+// `received` carries bytes read past that response over to the next call.
+// Throws std::runtime_error if the connection fails.
+Response request(int fd, std::string_view line, std::string &received);
+
+// Minimal blocking client: one request at a time.
+class Client {
+public:
+    explicit Client(const std::string &path);
+    ~Client();
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    Response request(std::string_view line) { return session::request(fd, line, received); }
+
+private:
+    int fd;
+    std::string received;
+};
+
+} // namespace session
+
+#endif // SESSION_PROTOCOL_H
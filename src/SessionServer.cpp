@@ -0,0 +1,498 @@
+// SessionServer.cpp
+#include "SessionServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "SessionProtocol.h"
+#include "Utils.h"
+
+struct SessionServer::Session {
+    Session(uint64_t id, int fd, const Interpreter::Snapshot &prelude)
+        : id(id),
+          interpreter(prelude ? std::make_unique<Interpreter>(prelude) : std::make_unique<Interpreter>()),
+          fd(fd) {
+        interpreter->setExecutionControl(&control);
+        // What one request prints is drained into its response, so it is held
+        // to half a frame, leaving the result room.
+        interpreter->output().setBufferLimit(session::kMaxPayload / 2);
+    }
+
+    const uint64_t id;
+    std::unique_ptr<Interpreter> interpreter; // used by one worker at a time
+    ExecutionControl control;
+
+    // I/O thread only.
+    int fd;                  // -1 once closed
+    std::string input;       // received bytes not yet split into requests
+    std::string sending;     // responses being written
+    size_t sent = 0;
+    uint32_t interest = EPOLLIN | EPOLLRDHUP; // events watched
+    bool inputDone = false;  // the peer shut down its side; answer, then close
+
+    // Shared with the workers.
+    std::mutex mutex;
+    std::deque<std::string> pending; // requests not yet evaluated
+    size_t pendingBytes = 0;
+    std::string responses;           // encoded, not yet handed to the I/O thread
+    bool scheduled = false;          // queued for or held by a worker
+    bool closed = false;
+};
+
+namespace {
+
+[[noreturn]] void fail(const std::string &what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void closeIfOpen(int &fd) {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void watch(int epollFd, int fd, uint32_t events, uint64_t id, int op = EPOLL_CTL_ADD) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (::epoll_ctl(epollFd, op, fd, &event) != 0) {
+        fail("epoll_ctl");
+    }
+}
+
+// A socket file left behind by a previous server would make bind fail, but
+// one a live server is listening on must be left alone: only a socket that
+// refuses connections is stale.
+void removeStaleSocket(const std::string &path, const sockaddr_un &address) {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return; // bind reports anything else in the way
+    }
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        fail("Cannot create socket");
+    }
+    int connected = ::connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof address);
+    int err = errno;
+    ::close(probe);
+    if (connected == 0) {
+        throw std::runtime_error("Another server is listening on " + path);
+    }
+    if (err != ECONNREFUSED) {
+        errno = err;
+        fail("Cannot check " + path);
+    }
+    ::unlink(path.c_str());
+}
+
+} // namespace
+
+SessionServer::SessionServer(Options opts) : options(std::move(opts)) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.size() >= sizeof address.sun_path) {
+        throw std::runtime_error("Socket path too long: " + options.socketPath);
+    }
+    std::memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+
+    try {
+        removeStaleSocket(options.socketPath, address);
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            fail("Cannot create socket");
+        }
+        if (::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0) {
+            fail("Cannot bind " + options.socketPath);
+        }
+        if (::listen(listenFd, SOMAXCONN) != 0) {
+            fail("Cannot listen on " + options.socketPath);
+        }
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            fail("epoll_create1");
+        }
+        wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd < 0) {
+            fail("eventfd");
+        }
+        watch(epollFd, listenFd, EPOLLIN, kListenId);
+        watch(epollFd, wakeFd, EPOLLIN, kWakeId);
+    } catch (...) {
+        closeIfOpen(wakeFd);
+        closeIfOpen(epollFd);
+        closeIfOpen(listenFd);
+        throw;
+    }
+
+    unsigned count = options.workers ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+SessionServer::~SessionServer() {
+    stop();
+    for (auto &[id, session] : sessions) {
+        session->control.cancelRequested.store(true, std::memory_order_relaxed);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &[id, session] : sessions) {
+        closeIfOpen(session->fd);
+    }
+    closeIfOpen(wakeFd);
+    closeIfOpen(epollFd);
+    closeIfOpen(listenFd);
+    ::unlink(options.socketPath.c_str());
+}
+
+void SessionServer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        stopping.store(true, std::memory_order_release);
+    }
+    runWake.notify_all();
+    wakeIoThread();
+}
+
+void SessionServer::wakeIoThread() {
+    uint64_t one = 1;
+    // Can only fail if the counter would overflow, i.e. a wakeup is pending anyway.
+    [[maybe_unused]] ssize_t n = ::write(wakeFd, &one, sizeof one);
+}
+
+void SessionServer::run() {
+    epoll_event events[256];
+    while (!stopping.load(std::memory_order_acquire)) {
+        int ready = ::epoll_wait(epollFd, events, 256, acceptPaused ? kAcceptRetryMs : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            fail("epoll_wait");
+        }
+        if (ready == 0) {
+            resumeAccepting();
+            continue;
+        }
+        for (int i = 0; i < ready; ++i) {
+            uint64_t id = events[i].data.u64;
+            uint32_t flags = events[i].events;
+            if (id == kListenId) {
+                acceptConnections();
+            } else if (id == kWakeId) {
+                uint64_t count;
+                [[maybe_unused]] ssize_t n = ::read(wakeFd, &count, sizeof count);
+                collectResponses();
+            } else if (auto it = sessions.find(id); it != sessions.end()) {
+                SessionPtr session = it->second;
+                if (flags & (EPOLLHUP | EPOLLERR)) {
+                    // Gone in both directions: nobody is left to answer.
+                    closeSession(session);
+                    continue;
+                }
+                if (flags & (EPOLLIN | EPOLLRDHUP)) {
+                    readFrom(session);
+                }
+                if (session->fd >= 0 && (flags & EPOLLOUT)) {
+                    writeTo(session);
+                }
+            }
+        }
+    }
+}
+
+void SessionServer::acceptConnections() {
+    for (;;) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // The connection stays queued, so the listening socket stays
+                // readable: watching it now would spin.
+                pauseAccepting();
+            }
+            return; // EAGAIN: no more pending
+        }
+        auto session = std::make_shared<Session>(nextSessionId++, fd, options.prelude);
+        watch(epollFd, fd, EPOLLIN | EPOLLRDHUP, session->id);
+        sessions.emplace(session->id, std::move(session));
+        liveSessions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SessionServer::pauseAccepting() {
+    if (!acceptPaused) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+        acceptPaused = true;
+    }
+}
+
+void SessionServer::resumeAccepting() {
+    if (acceptPaused) {
+        watch(epollFd, listenFd, EPOLLIN, kListenId);
+        acceptPaused = false;
+    }
+}
+
+void SessionServer::readFrom(const SessionPtr &session) {
+    // Reads up to the backlog cap; the rest waits in the socket until the
+    // session has caught up (see updateInterest()).
+    size_t backlog = session->input.size() + (session->sending.size() - session->sent);
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        backlog += session->pendingBytes + session->responses.size();
+    }
+    bool peerDone = false;
+    bool failed = false;
+    char chunk[16384];
+    while (backlog < kMaxBacklog) {
+        ssize_t n = ::recv(session->fd, chunk, sizeof chunk, 0);
+        if (n > 0) {
+            session->input.append(chunk, static_cast<size_t>(n));
+            backlog += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        peerDone = n == 0;
+        failed = n < 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+        break;
+    }
+
+    std::vector<std::string> requests;
+    size_t consumed = 0;
+    try {
+        std::string_view payload;
+        size_t frameSize = 0;
+        while (session::nextFrame(std::string_view(session->input).substr(consumed), payload, frameSize)) {
+            requests.emplace_back(payload);
+            consumed += frameSize;
+        }
+    } catch (const std::runtime_error &) {
+        // Oversized message: the stream can't be resynchronised.
+        failed = true;
+    }
+    session->input.erase(0, consumed);
+    if (failed) {
+        closeSession(session);
+        return;
+    }
+
+    if (!requests.empty()) {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            for (auto &request : requests) {
+                session->pendingBytes += request.size();
+                session->pending.push_back(std::move(request));
+            }
+            idle = !std::exchange(session->scheduled, true);
+        }
+        if (idle) {
+            schedule(session);
+        }
+    }
+    if (peerDone) {
+        // A half-close: the requests already sent still get their responses.
+        // A partial frame can't be completed any more.
+        session->inputDone = true;
+        session->input.clear();
+    }
+    if (!finishIfAnswered(session)) {
+        updateInterest(session);
+    }
+}
+
+void SessionServer::writeTo(const SessionPtr &session) {
+    while (session->sent < session->sending.size() || takeResponses(session)) {
+        ssize_t n = ::send(session->fd, session->sending.data() + session->sent,
+                           session->sending.size() - session->sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n >= 0) {
+            session->sent += static_cast<size_t>(n);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            updateInterest(session);
+            return;
+        } else if (errno != EINTR) {
+            closeSession(session);
+            return;
+        }
+    }
+    if (!finishIfAnswered(session)) {
+        updateInterest(session);
+    }
+}
+
+bool SessionServer::takeResponses(const SessionPtr &session) {
+    bool resume = false;
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (session->responses.empty()) {
+            return false;
+        }
+        session->sending.clear();
+        session->sending.swap(session->responses);
+        // Workers skip a session whose responses are over the cap.
+        resume = !session->closed && !session->scheduled && !session->pending.empty();
+        session->scheduled = session->scheduled || resume;
+    }
+    session->sent = 0;
+    if (resume) {
+        schedule(session);
+    }
+    return true;
+}
+
+bool SessionServer::finishIfAnswered(const SessionPtr &session) {
+    if (!session->inputDone || session->sent < session->sending.size()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (!session->pending.empty() || session->scheduled || !session->responses.empty()) {
+            return false;
+        }
+    }
+    closeSession(session);
+    return true;
+}
+
+void SessionServer::updateInterest(const SessionPtr &session) {
+    size_t unsent = session->sending.size() - session->sent;
+    size_t backlog = session->input.size() + unsent;
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        backlog += session->pendingBytes + session->responses.size();
+    }
+    uint32_t events = 0;
+    if (!session->inputDone && backlog < kMaxBacklog) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (unsent > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != session->interest) {
+        watch(epollFd, session->fd, events, session->id, EPOLL_CTL_MOD);
+        session->interest = events;
+    }
+}
+
+void SessionServer::closeSession(const SessionPtr &session) {
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, session->fd, nullptr);
+    closeIfOpen(session->fd);
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->closed = true;
+        session->pending.clear();
+        session->pendingBytes = 0;
+    }
+    // Nobody is waiting for the result of a running evaluation any more.
+    session->control.cancelRequested.store(true, std::memory_order_relaxed);
+    sessions.erase(session->id);
+    liveSessions.fetch_sub(1, std::memory_order_relaxed);
+    // An fd is free again.
+    resumeAccepting();
+}
+
+void SessionServer::collectResponses() {
+    std::vector<SessionPtr> ready;
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        ready.swap(done);
+    }
+    for (const auto &session : ready) {
+        // Otherwise the responses are taken once the socket has room for what
+        // is already being written (EPOLLOUT).
+        if (session->fd >= 0 && session->sent == session->sending.size()) {
+            writeTo(session);
+        }
+    }
+}
+
+void SessionServer::schedule(const SessionPtr &session) {
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        runQueue.push_back(session);
+    }
+    runWake.notify_one();
+}
+
+void SessionServer::workerLoop() {
+    for (;;) {
+        SessionPtr session;
+        {
+            std::unique_lock<std::mutex> lock(runMutex);
+            runWake.wait(lock, [this] { return stopping.load(std::memory_order_relaxed) || !runQueue.empty(); });
+            if (stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            session = std::move(runQueue.front());
+            runQueue.pop_front();
+        }
+
+        std::string request;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            // A session whose client isn't reading waits until the I/O thread
+            // takes its responses (see takeResponses()).
+            if (session->closed || session->pending.empty() || session->responses.size() >= kMaxBacklog) {
+                session->scheduled = false;
+                continue;
+            }
+            request = std::move(session->pending.front());
+            session->pending.pop_front();
+            session->pendingBytes -= request.size();
+        }
+
+        // The response carries what the request printed, then its result or
+        // error message.
+        session::Status status = session::Status::Ok;
+        std::string text;
+        auto takeOutput = [&] {
+            session->interpreter->output().drain([&](std::string_view printed) { text += printed; });
+        };
+        try {
+            std::any result = session->interpreter->evaluate(request, false, options.budget);
+            takeOutput();
+            appendAnyString(text, result);
+        } catch (const std::exception &e) {
+            status = session::Status::Error;
+            takeOutput();
+            text += e.what();
+        }
+
+        // Responses are frames too, so they are held to kMaxPayload.
+        text.resize(std::min<size_t>(text.size(), session::kMaxPayload - 1));
+
+        // One request per turn; a session with more queued goes to the back.
+        bool more;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session::appendResponse(session->responses, status, text);
+            more = !session->closed && !session->pending.empty() && session->responses.size() < kMaxBacklog;
+            session->scheduled = more;
+        }
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            done.push_back(session);
+        }
+        wakeIoThread();
+        if (more) {
+            schedule(session);
+        }
+    }
+}
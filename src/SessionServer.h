@@ -0,0 +1,115 @@
+// SessionServer.h
+#ifndef SESSION_SERVER_H
+#define SESSION_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ExecutionBudget.h"
+#include "Interpreter.h"
+
+// Hosts many independent REPL sessions in one process. Every connection to
+// the Unix domain socket is a session with its own Interpreter. One thread
+// (the caller of run()) multiplexes all connections with epoll; evaluation
+// happens on a pool of worker threads, one request at a time per session and
+// in order, taking turns so a busy session can't starve the others. The wire
+// format is in SessionProtocol.h.
+class SessionServer {
+public:
+    struct Options {
+        std::string socketPath;
+        unsigned workers = 0;     // 0 = one per hardware thread
+        ExecutionBudget budget;   // applied to every request
+        Interpreter::Snapshot prelude; // if set, every session starts from it
+    };
+
+    // Binds and listens on options.socketPath, replacing a socket file that
+    // nothing is listening on. Throws std::runtime_error on failure, including
+    // when another server is using the path.
+    explicit SessionServer(Options options);
+    // Stops, cancels running evaluations, and removes the socket file.
+    ~SessionServer();
+
+    SessionServer(const SessionServer &) = delete;
+    SessionServer &operator=(const SessionServer &) = delete;
+
+    // Serves connections on the calling thread until stop().
+    void run();
+    // Makes run() return. Safe to call from any thread. Destroy the server
+    // only after run() has returned.
+    void stop();
+
+    size_t sessionCount() const { return liveSessions.load(std::memory_order_relaxed); }
+
+private:
+    struct Session;
+    using SessionPtr = std::shared_ptr<Session>;
+
+    static constexpr uint64_t kListenId = 0;
+    static constexpr uint64_t kWakeId = 1;
+    static constexpr uint64_t kFirstSessionId = 2;
+
+    // A session's requests waiting for a worker plus its responses not yet
+    // sent: past this, it is not read from (and with that many responses
+    // unsent, not evaluated either) until it catches up, so a client that
+    // pipelines without reading can't grow the server without bound.
+    static constexpr size_t kMaxBacklog = size_t{4} << 20; // 4 frames of kMaxPayload
+    // How long accepting stays paused after running out of fds, unless a
+    // session closes first.
+    static constexpr int kAcceptRetryMs = 100;
+
+    void acceptConnections();
+    void pauseAccepting();
+    void resumeAccepting();
+    void readFrom(const SessionPtr &session);
+    void writeTo(const SessionPtr &session);
+    // Moves the responses workers have finished to the session's send buffer.
+    // Returns false if there were none.
+    bool takeResponses(const SessionPtr &session);
+    // Closes a half-closed session once all its requests are answered.
+    // Returns whether it did.
+    bool finishIfAnswered(const SessionPtr &session);
+    // Watches the session for what it can do now: reading while under
+    // kMaxBacklog, writing while responses are unsent.
+    void updateInterest(const SessionPtr &session);
+    void closeSession(const SessionPtr &session);
+    void collectResponses();
+    void schedule(const SessionPtr &session);
+    void workerLoop();
+    void wakeIoThread();
+
+    Options options;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd: stop requests and finished responses
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> liveSessions{0};
+    bool acceptPaused = false; // I/O thread only
+
+    // I/O thread only. Keyed by an id that is never reused (unlike fds), which
+    // is also the epoll data of the session's socket.
+    std::unordered_map<uint64_t, SessionPtr> sessions;
+    uint64_t nextSessionId = kFirstSessionId;
+
+    // Sessions with requests waiting for a worker.
+    std::mutex runMutex;
+    std::condition_variable runWake;
+    std::deque<SessionPtr> runQueue;
+
+    // Sessions with responses for the I/O thread to send.
+    std::mutex doneMutex;
+    std::vector<SessionPtr> done;
+
+    std::vector<std::thread> workers; // last, so they start after everything they use exists
+};
+
+#endif // SESSION_SERVER_H
@@ -0,0 +1,136 @@
+// Trace.cpp
+#include "Trace.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'C', 'I', 'T'};
+constexpr uint32_t kFormatVersion = 1;
+
+// One thread's events. Only the owning thread writes; `written` is the total
+// number of events ever recorded, so the ring holds the last
+// min(written, kRingCapacity) of them.
+struct ThreadBuffer {
+    uint32_t thread = 0;
+    std::atomic<uint64_t> written{0};
+    std::array<Record, kRingCapacity> ring;
+};
+
+// Registry of all buffers, so a snapshot can reach other threads' events.
+// Buffers are shared with the registry and outlive their threads.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Only the first event of a thread allocates and takes the registry lock.
+ThreadBuffer &localBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        created->thread = static_cast<uint32_t>(reg.buffers.size());
+        reg.buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+} // namespace
+
+void record(uint16_t level, TraceEvent event, int64_t a, int64_t b) noexcept {
+    ThreadBuffer &buffer = localBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    Record &slot = buffer.ring[index % kRingCapacity];
+    slot.timestampNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    slot.event = static_cast<uint16_t>(event);
+    slot.level = level;
+    slot.thread = buffer.thread;
+    slot.a = a;
+    slot.b = b;
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+// Layout: magic, format version, record count, then the records.
+void writeSnapshot(std::ostream &out) {
+    std::vector<Record> records;
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto &buffer : reg.buffers) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t first = written > kRingCapacity ? written - kRingCapacity : 0;
+            for (uint64_t i = first; i < written; ++i) {
+                records.push_back(buffer->ring[i % kRingCapacity]);
+            }
+        }
+    }
+    uint64_t count = records.size();
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char *>(&kFormatVersion), sizeof(kFormatVersion));
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char *>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(Record)));
+}
+
+bool decode(std::istream &in, std::ostream &out) {
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !in.read(reinterpret_cast<char *>(&version), sizeof(version)) || version != kFormatVersion ||
+        !in.read(reinterpret_cast<char *>(&count), sizeof(count))) {
+        return false;
+    }
+    uint64_t origin = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        Record r{};
+        if (!in.read(reinterpret_cast<char *>(&r), sizeof(r))) {
+            return false;
+        }
+        if (i == 0) {
+            origin = r.timestampNs;
+        }
+        // Times are relative to the first event, in microseconds.
+        double us = static_cast<double>(static_cast<int64_t>(r.timestampNs - origin)) / 1000.0;
+        out << us << "us T" << r.thread << " L" << r.level << ' ' << eventName(r.event)
+            << " a=" << r.a << " b=" << r.b << '\n';
+    }
+    return true;
+}
+
+const char *eventName(uint16_t event) {
+    switch (static_cast<TraceEvent>(event)) {
+        case TraceEvent::ReplLine:      return "ReplLine";
+        case TraceEvent::ReplExit:      return "ReplExit";
+        case TraceEvent::ReplEmpty:     return "ReplEmpty";
+        case TraceEvent::ReplResult:    return "ReplResult";
+        case TraceEvent::ReplError:     return "ReplError";
+        case TraceEvent::ReplEnd:       return "ReplEnd";
+        case TraceEvent::Evaluate:      return "Evaluate";
+        case TraceEvent::ForEnter:      return "ForEnter";
+        case TraceEvent::ForIteration:  return "ForIteration";
+        case TraceEvent::ForExit:       return "ForExit";
+        case TraceEvent::CallEnter:     return "CallEnter";
+    }
+    return "Unknown";
+}
+
+} // namespace trace
@@ -0,0 +1,80 @@
+// Trace.h
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <iosfwd>
+
+// Structured tracing with compile-time levels.
+//
+//   TRACE(level, TraceEvent::X, a, b)
+//
+// compiles to nothing (the arguments are not even evaluated) when level is
+// above VCI_TRACE_LEVEL. Otherwise it appends one fixed-size binary record to
+// the calling thread's ring buffer: no formatting, no locking, no flushing,
+// and no allocation after the thread's first event. Buffers are written out
+// with trace::writeSnapshot() and turned into text offline by
+// trace::decode() (see `VersatileCInterpreter --decode-trace`).
+
+#define VCI_TRACE_OFF 0
+#define VCI_TRACE_INFO 1   // one event per REPL line / evaluation
+#define VCI_TRACE_DEBUG 2  // per-iteration and per-call events
+
+#ifndef VCI_TRACE_LEVEL
+#define VCI_TRACE_LEVEL VCI_TRACE_OFF
+#endif
+
+// Event kinds. Append only: the numeric values are stored in trace files.
+enum class TraceEvent : uint16_t {
+    ReplLine = 1,        // a = line length
+    ReplExit,            //
+    ReplEmpty,           //
+    ReplResult,          // a = result length
+    ReplError,           //
+    ReplEnd,             //
+    Evaluate,            // a = source length, b = 1 for file mode
+    ForEnter,            // a = source line
+    ForIteration,        // a = source line, b = iteration
+    ForExit,             // a = source line, b = iterations
+    CallEnter,           // a = source line of the body, b = argument count
+};
+
+namespace trace {
+
+// One event as stored in the ring buffer and in trace files (32 bytes).
+struct Record {
+    uint64_t timestampNs; // steady clock
+    uint16_t event;       // TraceEvent
+    uint16_t level;
+    uint32_t thread;      // index of the recording thread, in order of first event
+    int64_t a;
+    int64_t b;
+};
+
+// Events kept per thread; older ones are overwritten.
+constexpr uint32_t kRingCapacity = 8192;
+
+void record(uint16_t level, TraceEvent event, int64_t a = 0, int64_t b = 0) noexcept;
+
+// Writes every thread's buffered events, oldest first per thread. Call it
+// while the traced threads are idle (e.g. at exit); a snapshot taken during
+// tracing may contain torn records.
+void writeSnapshot(std::ostream &out);
+
+// Turns a snapshot into one line of text per event. Returns false if the
+// input is not a trace snapshot.
+bool decode(std::istream &in, std::ostream &out);
+
+// Name of an event kind, for decoders.
+const char *eventName(uint16_t event);
+
+} // namespace trace
+
+#define TRACE(level, event, ...)                                             \
+    do {                                                                     \
+        if constexpr ((level) <= VCI_TRACE_LEVEL) {                          \
+            ::trace::record((level), (event) __VA_OPT__(,) __VA_ARGS__);     \
+        }                                                                    \
+    } while (0)
+
+#endif // TRACE_H
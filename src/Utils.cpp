@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <any>
+#include <cctype>
+#include <charconv>
 #include <string>
 
 // A helper function to convert a VarValue to a boolean.
@@ -29,21 +31,44 @@ std::string trim(const std::string &s) {
             ? std::string(ws_front, ws_back)
             : std::string());
 }
+// Trim whitespace from both ends, as a view
+std::string_view trimView(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
 // Helper function to convert std::any to a string
 std::string anyToString(const std::any &value) {
-    try {
-        if (value.type() == typeid(int)) {
-            return std::to_string(std::any_cast<int>(value));
-        } else if (value.type() == typeid(double)) {
-            return std::to_string(std::any_cast<double>(value));
-        } else if (value.type() == typeid(char)) {
-            return std::string(1, std::any_cast<char>(value));
-        } else if (value.has_value()) {
-            return "[Unknown type]";
-        } else {
-            return "[No value]";
-        }
-    } catch (const std::bad_any_cast &) {
-        return "[Type conversion error]";
+    std::string out;
+    appendAnyString(out, value);
+    return out;
+}
+
+void appendAnyString(std::string &out, const std::any &value) {
+    NumberText digits;
+    if (value.type() == typeid(int)) {
+        out.append(formatNumber(digits, *std::any_cast<int>(&value)));
+    } else if (value.type() == typeid(double)) {
+        out.append(formatNumber(digits, *std::any_cast<double>(&value)));
+    } else if (value.type() == typeid(char)) {
+        out.push_back(*std::any_cast<char>(&value));
+    } else if (value.has_value()) {
+        out += "[Unknown type]";
+    } else {
+        out += "[No value]";
     }
 }
+
+std::string_view formatNumber(NumberText &text, int value) {
+    auto written = std::to_chars(text.data(), text.data() + text.size(), value);
+    return {text.data(), static_cast<size_t>(written.ptr - text.data())};
+}
+
+std::string_view formatNumber(NumberText &text, double value) {
+    auto written = std::to_chars(text.data(), text.data() + text.size(), value, std::chars_format::fixed, 6);
+    return {text.data(), static_cast<size_t>(written.ptr - text.data())};
+}
@@ -2,10 +2,12 @@
 #define UTILS_H
 
 #include <any>
+#include <array>
 
 #include "Variable.h"
 #include <variant>
 #include <string>
+#include <string_view>
 
 // A helper function to convert a VarValue to a boolean.
 bool convertToBool(const VarValue &value);
@@ -13,8 +15,24 @@ bool convertToBool(const VarValue &value);
 // Convert any std::any to a string (for REPL output), including std::string
 std::string anyToString(const std::any &value);
 
+// Same text as anyToString, appended to `out` without a temporary string.
+void appendAnyString(std::string &out, const std::any &value);
+
+// Room for any number formatNumber writes; the longest is a double in fixed
+// notation.
+using NumberText = std::array<char, 320>;
+
+// Formats `value` into `text` with std::to_chars (on the stack, no locale
+// lookups) and returns the part written. Doubles get six decimals in fixed
+// notation, like printf's "%f" and std::to_string.
+std::string_view formatNumber(NumberText &text, int value);
+std::string_view formatNumber(NumberText &text, double value);
+
 // Trim whitespace from both ends
 std::string trim(const std::string &s);
 
+// Same, as a view into `s` (no copy).
+std::string_view trimView(std::string_view s);
+
 
 #endif // UTILS_H
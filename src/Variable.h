@@ -1,5 +1,6 @@
 #ifndef VARIABLE_H
 #define VARIABLE_H
+#include <type_traits>
 #include <variant>
 
 // Enum for variable types.
@@ -13,4 +14,18 @@ struct Variable {
     VarValue value;
 };
 
+// The VarType a native int/double/char maps to.
+template<typename T>
+constexpr VarType nativeVarType() {
+    static_assert(std::is_same_v<T, int> || std::is_same_v<T, double> || std::is_same_v<T, char>,
+                  "Functions take and return int, double or char");
+    if constexpr (std::is_same_v<T, int>) {
+        return VarType::INT;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return VarType::DOUBLE;
+    } else {
+        return VarType::CHAR;
+    }
+}
+
 #endif // VARIABLE_H
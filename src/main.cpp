@@ -1,20 +1,348 @@
 // main.cpp
 #include "IReplUI.h"
 #include "ConsoleReplUI.h"
+#include "FramePacer.h"
+#ifdef VCI_WITH_GUI
 #include "ImGuiReplUI.h"
+#endif
+#include "Interpreter.h"
+#include "MappedFile.h"
+#include "PerfCounters.h"
+#include "REPL.h"
+#include "SessionServer.h"
+#include "Trace.h"
+#include "Utils.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Mode { Gui, Repl, Pipe, Serve, Run, Eval, DecodeTrace };
+
+struct Options {
+#ifdef VCI_WITH_GUI
+    Mode mode = Mode::Gui;
+#else
+    Mode mode = Mode::Repl;
+#endif
+    std::string file;       // --run
+    std::string code;       // --eval
+    std::string socketPath; // --serve
+    unsigned workers = 0;   // --workers
+    std::string cacheDir;   // --cache-dir
+    bool time = false;      // --time
+    ExecutionBudget budget; // --max-steps, --max-depth, --timeout-ms
+    std::string traceOut;   // --trace-out
+    std::string traceIn;    // --decode-trace
+    std::string profileOut; // --profile
+    bool perf = false;      // --perf
+    double maxFps = FramePacer::kDefaultMaxFps; // --max-fps
+};
+
+void printUsage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " [mode] [options]\n"
+              << "Modes:\n"
+#ifdef VCI_WITH_GUI
+              << "  --gui              ImGui front end (default)\n"
+#endif
+              << "  --repl             interactive REPL on stdin/stdout\n"
+              << "  --pipe             evaluate stdin line by line, results on stdout (for scripts)\n"
+              << "  --serve SOCKET     host REPL sessions on a Unix domain socket\n"
+              << "  --run FILE         run FILE as a program and print main's result\n"
+              << "  --eval CODE        evaluate CODE as a REPL line and print the result\n"
+              << "  --decode-trace F   print the events in trace snapshot F\n"
+              << "Options:\n"
+              << "  --workers N        evaluation threads for --serve (default: one per core)\n"
+              << "  --cache-dir DIR    cache parsed programs for --run in DIR\n"
+              << "  --time             report load/evaluate times on stderr\n"
+              << "                     (and allocations, in a build with VCI_TRACK_ALLOCATIONS)\n"
+              << "  --max-steps N      abort after N loop iterations and calls\n"
+              << "  --max-depth N      abort beyond N nested calls\n"
+              << "  --timeout-ms N     abort after N milliseconds\n"
+              << "  --profile FILE     profile the run: folded stacks to FILE, summary to stderr\n"
+              << "  --perf             report hardware counters for the evaluation on stderr\n"
+#ifdef VCI_WITH_GUI
+              << "  --max-fps N        cap the GUI frame rate (default 60, 0 = uncapped)\n"
+#endif
+              << "  --trace-out FILE   write a trace snapshot to FILE on exit\n"
+              << "                     (needs a build with VCI_TRACE_LEVEL > 0)\n";
+}
+
+unsigned long long parseCount(const std::string &text, const char *flag) {
+    try {
+        size_t used = 0;
+        unsigned long long value = std::stoull(text, &used);
+        if (used == text.size() && text.front() != '-') {
+            return value;
+        }
+    } catch (const std::exception &) {
+    }
+    std::cerr << flag << " expects a non-negative number\n";
+    std::exit(2);
+}
+
+double millisSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void enableProfiling(const Options &options, Interpreter &interpreter) {
+    if (!options.profileOut.empty()) {
+        interpreter.enableProfiling(true);
+    }
+}
+
+// Folded stacks go to the --profile file (for flamegraph tools), the summary
+// to stderr.
+void reportProfile(const Options &options, Interpreter &interpreter) {
+    if (options.profileOut.empty()) {
+        return;
+    }
+    std::ofstream folded(options.profileOut, std::ios::trunc);
+    interpreter.profiler()->writeFolded(folded);
+    if (!folded) {
+        std::cerr << "Could not write profile to " << options.profileOut << "\n";
+    }
+    interpreter.profiler()->writeSummary(std::cerr);
+}
+
+// Part of --time: heap allocations of the evaluation, by phase.
+void reportAllocations(const Interpreter &interpreter) {
+    if (allocations::enabled()) {
+        std::cerr << "[alloc] ";
+        writeAllocations(std::cerr, interpreter.lastEvaluationAllocations());
+        std::cerr << "\n";
+    }
+}
+
+// --run and --eval: what the program prints goes to stdout as it fills the
+// buffer, ahead of the result. Anything left when the interpreter goes away
+// (e.g. on an error) is flushed then.
+void printProgramOutput(Interpreter &interpreter) {
+    interpreter.output().setFlushTarget([](std::string_view text) {
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    });
+}
+
+// Runs evaluate under hardware counters if --perf was given. The counters
+// are opened before and read after, so only the evaluation itself is counted.
+template<typename Evaluate>
+std::any evaluateCounted(const Options &options, Evaluate &&evaluate) {
+    if (!options.perf) {
+        return evaluate();
+    }
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::cerr << "[perf] counters unavailable: " << counters.unavailableReason() << "\n";
+        return evaluate();
+    }
+    counters.start();
+    std::any result = evaluate();
+    writePerfSample(std::cerr, counters.stop());
+    return result;
+}
+
+// --run: the file is mapped and handed to the interpreter as a view, so the
+// source is never copied on our side.
+int runFile(const Options &options, Clock::time_point start) {
+    auto loadStart = Clock::now();
+    MappedFile file(options.file);
+    double loadMs = millisSince(loadStart);
+
+    Interpreter interpreter;
+    printProgramOutput(interpreter);
+    if (!options.cacheDir.empty()) {
+        interpreter.enableProgramCache(options.cacheDir);
+    }
+    enableProfiling(options, interpreter);
+    auto evalStart = Clock::now();
+    std::any result = evaluateCounted(options, [&] {
+        return interpreter.evaluate(file.view(), true, options.budget);
+    });
+    double evalMs = millisSince(evalStart);
+    reportProfile(options, interpreter);
+
+    interpreter.output().flush();
+    std::cout << anyToString(result) << '\n';
+    if (options.time) {
+        std::cerr << "[time] load: " << loadMs << " ms, evaluate: " << evalMs
+                  << " ms, total since main: " << millisSince(start) << " ms\n";
+        reportAllocations(interpreter);
+    }
+    return 0;
+}
+
+int decodeTrace(const Options &options) {
+    std::ifstream in(options.traceIn, std::ios::binary);
+    if (!in || !trace::decode(in, std::cout)) {
+        std::cerr << "Not a trace snapshot: " << options.traceIn << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Writes the trace snapshot when main returns, whichever mode ran.
+struct TraceSnapshotOnExit {
+    const std::string &path;
+    ~TraceSnapshotOnExit() {
+        if (path.empty()) {
+            return;
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        trace::writeSnapshot(out);
+        if (!out) {
+            std::cerr << "Could not write trace snapshot to " << path << "\n";
+        }
+    }
+};
+
+int evalCode(const Options &options, Clock::time_point start) {
+    Interpreter interpreter;
+    printProgramOutput(interpreter);
+    enableProfiling(options, interpreter);
+    auto evalStart = Clock::now();
+    std::any result = evaluateCounted(options, [&] {
+        return interpreter.evaluate(options.code, false, options.budget);
+    });
+    double evalMs = millisSince(evalStart);
+    reportProfile(options, interpreter);
+
+    interpreter.output().flush();
+    std::cout << anyToString(result) << '\n';
+    if (options.time) {
+        std::cerr << "[time] evaluate: " << evalMs
+                  << " ms, total since main: " << millisSince(start) << " ms\n";
+        reportAllocations(interpreter);
+    }
+    return 0;
+}
+
+} // namespace
 
 int main(int argc, char** argv) {
-    std::unique_ptr<IReplUI> ui;
-    // if (argc > 1 && std::string(argv[1]) == "--gui") {
-    //     ui = std::make_unique<ImGuiReplUI>();
-    // } else {
-    //     ui = std::make_unique<ConsoleReplUI>();
-    // }
-
-    // ui = std::make_unique<ConsoleReplUI>();
-    ui = std::make_unique<ImGuiReplUI>();
-    ui->run();
+    auto start = Clock::now();
+
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto needValue = [&](const char *flag) -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << flag << " needs an argument\n";
+                printUsage(argv[0]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--repl") {
+            options.mode = Mode::Repl;
+        } else if (arg == "--pipe") {
+            options.mode = Mode::Pipe;
+        } else if (arg == "--serve") {
+            options.mode = Mode::Serve;
+            options.socketPath = needValue("--serve");
+        } else if (arg == "--workers") {
+            options.workers = static_cast<unsigned>(parseCount(needValue("--workers"), "--workers"));
+        } else if (arg == "--gui") {
+#ifdef VCI_WITH_GUI
+            options.mode = Mode::Gui;
+#else
+            std::cerr << "This build has no GUI; rebuild with VCI_BUILD_GUI=ON\n";
+            return 2;
+#endif
+        } else if (arg == "--run") {
+            options.mode = Mode::Run;
+            options.file = needValue("--run");
+        } else if (arg == "--eval") {
+            options.mode = Mode::Eval;
+            options.code = needValue("--eval");
+        } else if (arg == "--decode-trace") {
+            options.mode = Mode::DecodeTrace;
+            options.traceIn = needValue("--decode-trace");
+        } else if (arg == "--trace-out") {
+            options.traceOut = needValue("--trace-out");
+            if (VCI_TRACE_LEVEL == VCI_TRACE_OFF) {
+                std::cerr << "Note: tracing is compiled out; the snapshot will be empty\n";
+            }
+        } else if (arg == "--profile") {
+            options.profileOut = needValue("--profile");
+        } else if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg == "--max-fps") {
+            options.maxFps = static_cast<double>(parseCount(needValue("--max-fps"), "--max-fps"));
+        } else if (arg == "--cache-dir") {
+            options.cacheDir = needValue("--cache-dir");
+        } else if (arg == "--time") {
+            options.time = true;
+        } else if (arg == "--max-steps") {
+            options.budget.maxSteps = parseCount(needValue("--max-steps"), "--max-steps");
+        } else if (arg == "--max-depth") {
+            options.budget.maxCallDepth = static_cast<unsigned>(parseCount(needValue("--max-depth"), "--max-depth"));
+        } else if (arg == "--timeout-ms") {
+            options.budget.timeout = std::chrono::milliseconds(parseCount(needValue("--timeout-ms"), "--timeout-ms"));
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    TraceSnapshotOnExit traceSnapshot{options.traceOut};
+    try {
+        switch (options.mode) {
+            case Mode::DecodeTrace:
+                return decodeTrace(options);
+            case Mode::Run:
+                return runFile(options, start);
+            case Mode::Eval:
+                return evalCode(options, start);
+            case Mode::Repl: {
+                std::unique_ptr<IReplUI> ui = std::make_unique<ConsoleReplUI>();
+                ui->run();
+                return 0;
+            }
+            case Mode::Pipe: {
+                // Nothing else touches the standard streams in this mode, so
+                // they can bypass stdio's per-call locking.
+                std::ios::sync_with_stdio(false);
+                std::cin.tie(nullptr);
+                REPL repl;
+                repl.runPipe(std::cin, std::cout);
+                return 0;
+            }
+            case Mode::Serve: {
+                SessionServer::Options serverOptions;
+                serverOptions.socketPath = options.socketPath;
+                serverOptions.workers = options.workers;
+                serverOptions.budget = options.budget;
+                SessionServer server(serverOptions);
+                std::cerr << "Serving sessions on " << options.socketPath << "\n";
+                server.run();
+                return 0;
+            }
+            case Mode::Gui: {
+#ifdef VCI_WITH_GUI
+                std::unique_ptr<IReplUI> ui = std::make_unique<ImGuiReplUI>(options.maxFps);
+                ui->run();
+#endif
+                return 0;
+            }
+        }
+    } catch (const BudgetExceeded &e) {
+        std::cerr << "Budget exceeded: " << e.what() << "\n";
+        return 3;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,42 @@
+// AllocationAssertions.h
+#ifndef ALLOCATION_ASSERTIONS_H
+#define ALLOCATION_ASSERTIONS_H
+
+#include "gtest/gtest.h"
+#include "AllocationTracker.h"
+#include <cstdint>
+#include <utility>
+
+// Regression guards for memory churn. Runs body `warmup` times (so caches,
+// hash tables and vectors reach their steady size), then `iterations` more
+// times, and fails if those later runs made more than `perIteration`
+// allocations each on average:
+//
+//     EXPECT_TRUE(allocatesAtMost(0, [&] { env.get("x"); }));
+//
+// Succeeds trivially in builds without VCI_TRACK_ALLOCATIONS.
+template<typename Body>
+::testing::AssertionResult allocatesAtMost(uint64_t perIteration, Body &&body, int warmup = 2,
+                                           int iterations = 100) {
+    for (int i = 0; i < warmup; ++i) {
+        body();
+    }
+    AllocationScope scope;
+    for (int i = 0; i < iterations; ++i) {
+        body();
+    }
+    AllocationCounts counts = scope.counts();
+    if (counts.allocations <= perIteration * static_cast<uint64_t>(iterations)) {
+        return ::testing::AssertionSuccess();
+    }
+    return ::testing::AssertionFailure() << iterations << " steady-state iterations made " << counts.allocations
+                                         << " allocations (" << counts.bytes << " bytes), more than "
+                                         << perIteration << " per iteration";
+}
+
+template<typename Body>
+::testing::AssertionResult allocatesNothing(Body &&body, int warmup = 2, int iterations = 100) {
+    return allocatesAtMost(0, std::forward<Body>(body), warmup, iterations);
+}
+
+#endif // ALLOCATION_ASSERTIONS_H
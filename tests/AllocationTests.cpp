@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include "AllocationAssertions.h"
+#include "ExecutionBudget.h"
+#include "Environment.h"
+#include "Interpreter.h"
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *kProgram =
+    "int add(int a, int b) { return a + b; }\n"
+    "int main() {\n"
+    "    int s = 0;\n"
+    "    int i = 0;\n"
+    "    while (i < 10) { s = add(s, i); i = i + 1; }\n"
+    "    return s;\n"
+    "}\n";
+
+} // namespace
+
+TEST(AllocationTrackerTest, CountsThisThreadsAllocations) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    AllocationScope scope;
+    void *p = ::operator new(1000);
+    ::operator delete(p);
+    std::vector<int> v(25);
+    AllocationCounts counts = scope.counts();
+    EXPECT_EQ(counts.allocations, 2u);
+    EXPECT_EQ(counts.bytes, 1000u + 25 * sizeof(int));
+}
+
+TEST(AllocationTrackerTest, IgnoresOtherThreads) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    std::atomic<bool> go{false};
+    std::thread other([&] {
+        while (!go.load()) {
+            std::this_thread::yield();
+        }
+        for (int i = 0; i < 10; ++i) {
+            std::vector<int> v(100);
+        }
+    });
+    AllocationScope scope;
+    go.store(true);
+    other.join();
+    EXPECT_EQ(scope.counts().allocations, 0u);
+}
+
+TEST(AllocationTrackerTest, EvaluateReportsEachPhase) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    Interpreter interpreter;
+    AllocationScope scope;
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(kProgram, true)), 45);
+    AllocationCounts outside = scope.counts();
+
+    EvaluationAllocations counts = interpreter.lastEvaluationAllocations();
+    EXPECT_GT(counts.lex.allocations, 0u);
+    EXPECT_GT(counts.parse.allocations, 0u);
+    EXPECT_GT(counts.execute.allocations, 0u);
+    // Every allocation made inside evaluate() lands in exactly one phase.
+    EXPECT_LE(counts.total().allocations, outside.allocations);
+    EXPECT_GT(counts.total().bytes, 0u);
+
+    // The next evaluation starts from zero.
+    interpreter.evaluate("1;", false);
+    EXPECT_LT(interpreter.lastEvaluationAllocations().total().allocations, counts.total().allocations);
+}
+
+TEST(AllocationTrackerTest, PhasesAreRecordedWhenEvaluationThrows) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    Interpreter interpreter;
+    EXPECT_THROW(interpreter.evaluate("undefinedVariable + 1;", false), std::runtime_error);
+    EXPECT_GT(interpreter.lastEvaluationAllocations().parse.allocations, 0u);
+}
+
+TEST(AllocationAssertionsTest, DetectsAllocatingLoops) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    auto allocating = [] { std::vector<int> v(10); };
+    EXPECT_FALSE(allocatesNothing(allocating));
+    EXPECT_TRUE(allocatesAtMost(1, allocating));
+    EXPECT_FALSE(allocatesAtMost(1, [] { std::vector<int> a(1), b(1); }));
+}
+
+// Regression guards: paths that must stay allocation-free once warm.
+TEST(AllocationAssertionsTest, SteadyStateHotPathsDoNotAllocate) {
+    Environment env(nullptr);
+    env.define("x", VarType::INT, 1);
+    const std::string name = "x";
+    EXPECT_TRUE(allocatesNothing([&] { env.get(name); }));
+    EXPECT_TRUE(allocatesNothing([&] { env.assign(name, VarType::INT, 2); }));
+
+    ExecutionBudget budget;
+    budget.maxSteps = 1u << 30;
+    BudgetMeter meter(budget);
+    EXPECT_TRUE(allocatesNothing([&] { meter.step(); }));
+}
+
+// Ceilings on known churn, to be lowered as it is removed: one call of a
+// two-argument function, and one iteration of a simple while loop.
+TEST(AllocationAssertionsTest, InterpretedCallsStayUnderCeiling) {
+    Interpreter interpreter(Program::compile(
+        "int add(int a, int b) { return a + b; }\n"
+        "int loop(int n) { int i = 0; int s = 0; while (i < n) { s = s + i; i = i + 1; } return s; }\n"));
+    auto add = interpreter.function<int(int, int)>("add");
+    auto loop = interpreter.function<int(int)>("loop");
+    EXPECT_TRUE(allocatesAtMost(32, [&] { add(1, 2); }));
+    EXPECT_TRUE(allocatesAtMost(64 * 10 + 32, [&] { loop(10); }, 2, 20));
+}
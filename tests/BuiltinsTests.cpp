@@ -0,0 +1,184 @@
+#include "gtest/gtest.h"
+#include "AllocationAssertions.h"
+#include "Builtins.h"
+#include "Interpreter.h"
+#include "ProgramOutput.h"
+#include "REPL.h"
+#include "Utils.h"
+#include <any>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string drained(ProgramOutput &out) {
+    std::string text;
+    out.drain([&](std::string_view printed) { text += printed; });
+    return text;
+}
+
+// Evaluates code and returns what it printed.
+std::string printedBy(Interpreter &interpreter, const std::string &code, bool isFileMode = false) {
+    interpreter.evaluate(code, isFileMode);
+    return drained(interpreter.output());
+}
+
+} // namespace
+
+TEST(ProgramOutputTest, DrainHandsOverEverythingOnce) {
+    ProgramOutput out;
+    out.write("x = ");
+    out.writeInt(-42);
+    out.put(' ');
+    out.writeDouble(0.5);
+    EXPECT_EQ(drained(out), "x = -42 0.500000");
+    EXPECT_EQ(drained(out), "");
+    EXPECT_EQ(out.written(), 16u);
+}
+
+TEST(ProgramOutputTest, FlushTargetGetsFullBuffers) {
+    std::vector<std::string> flushed;
+    ProgramOutput out;
+    out.setFlushTarget([&](std::string_view text) { flushed.emplace_back(text); }, 4);
+    out.write("ab");
+    EXPECT_EQ(out.buffered(), 2u);
+    out.write("cd");
+    EXPECT_EQ(out.buffered(), 0u);
+    out.put('e');
+    // Changing the target flushes to the old one first.
+    out.setFlushTarget(nullptr);
+    out.write("kept");
+    EXPECT_EQ(flushed, (std::vector<std::string>{"abcd", "e"}));
+    EXPECT_EQ(drained(out), "kept");
+}
+
+TEST(ProgramOutputTest, ThresholdZeroWritesThrough) {
+    std::vector<std::string> flushed;
+    ProgramOutput out;
+    out.setFlushTarget([&](std::string_view text) { flushed.emplace_back(text); }, 0);
+    out.write("ab");
+    out.put('c');
+    out.writeInt(7);
+    EXPECT_EQ(out.buffered(), 0u);
+    EXPECT_EQ(flushed, (std::vector<std::string>{"ab", "c", "7"}));
+}
+
+TEST(ProgramOutputTest, UndrainedOutputIsCappedAtTheLimit) {
+    ProgramOutput out;
+    out.setBufferLimit(4);
+    out.write("abc");
+    out.write("def");
+    out.put('g');
+    EXPECT_EQ(out.buffered(), 4u);
+    EXPECT_EQ(out.written(), 7u);
+    EXPECT_EQ(drained(out), "abcd\n[3 more bytes of output dropped]\n");
+    out.write("hi");
+    EXPECT_EQ(drained(out), "hi");
+
+    // A flush target takes everything, however much.
+    std::string flushed;
+    out.setFlushTarget([&](std::string_view text) { flushed += text; });
+    out.write("abcdefgh");
+    out.flush();
+    EXPECT_EQ(flushed, "abcdefgh");
+}
+
+TEST(ProgramOutputTest, LargestDoubleIsPrintedInFull) {
+    ProgramOutput out;
+    out.writeDouble(-1.7976931348623157e308);
+    std::string text = drained(out);
+    EXPECT_EQ(text.size(), 317u);
+    EXPECT_EQ(text, anyToString(std::any(-1.7976931348623157e308)));
+}
+
+TEST(ProgramOutputTest, PrintingAllocatesNothingOnceGrown) {
+    ProgramOutput out;
+    std::string format = "%d %f %c %s\n";
+    BuiltinArgument args[] = {std::string_view(format), VarValue(7), VarValue(1.5), VarValue('c'),
+                              std::string_view("text")};
+    EXPECT_TRUE(allocatesNothing([&] {
+        callBuiltin(Builtin::Printf, "printf", args, out);
+        out.drain([](std::string_view) {});
+    }));
+}
+
+TEST(BuiltinsTest, PrintfFormatsEachConversion) {
+    ProgramOutput out;
+    std::string format = "%d|%f|%c|%s|100%%\n";
+    BuiltinArgument args[] = {std::string_view(format), VarValue(-3), VarValue(2), VarValue(65),
+                              std::string_view("hi")};
+    VarValue written = callBuiltin(Builtin::Printf, "printf", args, out);
+    EXPECT_EQ(drained(out), "-3|2.000000|A|hi|100%\n");
+    EXPECT_EQ(std::get<int>(written), 22);
+}
+
+TEST(BuiltinsTest, PrintfRejectsWhatItCannotFormat) {
+    ProgramOutput out;
+    auto format = [&](std::vector<BuiltinArgument> args) { callBuiltin(Builtin::Printf, "printf", args, out); };
+    EXPECT_THROW(format({}), std::runtime_error);
+    EXPECT_THROW(format({VarValue(1)}), std::runtime_error);                          // no format string
+    EXPECT_THROW(format({std::string_view("%d")}), std::runtime_error);               // missing argument
+    EXPECT_THROW(format({std::string_view("%x"), VarValue(1)}), std::runtime_error);  // unsupported
+    EXPECT_THROW(format({std::string_view("%s"), VarValue(1)}), std::runtime_error);  // not a literal
+    EXPECT_THROW(format({std::string_view("%d"), std::string_view("1")}), std::runtime_error);
+    EXPECT_THROW(format({std::string_view("50%")}), std::runtime_error);
+}
+
+TEST(BuiltinsTest, DecodesEscapes) {
+    EXPECT_EQ(decodeStringLiteral(R"("plain")"), "plain");
+    EXPECT_EQ(decodeStringLiteral(R"("a\tb\n")"), "a\tb\n");
+    EXPECT_EQ(decodeStringLiteral(R"("say \"hi\" \\ \'")"), "say \"hi\" \\ '");
+    EXPECT_EQ(decodeStringLiteral(R"("")"), "");
+}
+
+TEST(BuiltinsTest, ProgramsPrint) {
+    Interpreter interpreter;
+    EXPECT_EQ(printedBy(interpreter, "printf(\"%d + %d = %d\\n\", 2, 3, 2 + 3);"), "2 + 3 = 5\n");
+    EXPECT_EQ(printedBy(interpreter, "putchar('o'); putchar(107); putchar(10);"), "ok\n");
+    EXPECT_EQ(printedBy(interpreter, "puts(\"line\");"), "line\n");
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("printf(\"%f\", 1.25);", false)), 8);
+    EXPECT_EQ(drained(interpreter.output()), "1.250000");
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("putchar('a');", false)), 97);
+}
+
+TEST(BuiltinsTest, OutputComesOutInProgramOrder) {
+    Interpreter interpreter;
+    const std::string program =
+        "int show(int x) { printf(\"[%d]\", x); return x; }\n"
+        "int main() { int i; int s = 0; for (i = 0; i < 3; i = i + 1) { s = s + show(7); } puts(\"\"); return s; }\n";
+    EXPECT_EQ(printedBy(interpreter, program, true), "[7][7][7]\n");
+    // The same with every optimization off.
+    Interpreter plain;
+    OptimizerOptions off;
+    off.hoistLoopInvariants = false;
+    off.eliminateCommonSubexpressions = false;
+    off.inlineSmallFunctions = false;
+    plain.setOptimizerOptions(off);
+    EXPECT_EQ(printedBy(plain, program, true), "[7][7][7]\n");
+}
+
+TEST(BuiltinsTest, StringLiteralsOnlyGoToBuiltins) {
+    Interpreter interpreter;
+    EXPECT_THROW(interpreter.evaluate("int x = \"no\";", false), std::runtime_error);
+    EXPECT_THROW(interpreter.evaluate("int printf(int x) { return x; }", false), std::runtime_error);
+    EXPECT_THROW(interpreter.evaluate("puts(1);", false), std::runtime_error);
+}
+
+TEST(BuiltinsTest, FrontEndsShowOutputBeforeResults) {
+    REPL repl;
+    EXPECT_EQ(repl.evaluateCommand("puts(\"hello\"); 1 + 1;"), "hello\n2");
+    EXPECT_EQ(repl.evaluateCommand("printf(\"partial \"); 1 / 0;").rfind("partial Error: ", 0), 0u);
+
+    std::istringstream input("puts(\"a\"); 1;\nputchar('b');\n");
+    std::ostringstream output;
+    REPL pipe;
+    pipe.runPipe(input, output);
+    EXPECT_EQ(output.str(), "a\n1\nb98\n");
+
+    Interpreter interpreter(Program::compile("int greet(int n) { printf(\"hi %d\\n\", n); return n; }\n"));
+    auto greet = interpreter.function<int(int)>("greet");
+    EXPECT_EQ(greet(4), 4);
+    EXPECT_EQ(drained(interpreter.output()), "hi 4\n");
+}
@@ -110,7 +110,7 @@ TEST(EnvironmentTest, DefineAndLookupFunction) {
 
     env.defineFunction("foo", f);
     EXPECT_TRUE(env.functionExists("foo"));
-    Function* p = env.getFunction("foo");
+    const Function* p = env.getFunction("foo");
     ASSERT_NE(p, nullptr);
     EXPECT_EQ(p->returnType, VarType::INT);
     EXPECT_EQ(p->parameterNames.size(), 2u);
@@ -134,9 +134,32 @@ TEST(EnvironmentTest, FunctionParameterTypes) {
     f.parameterTypes  = {VarType::INT, VarType::DOUBLE};
     env.defineFunction("mix", f);
 
-    Function* p = env.getFunction("mix");
+    const Function* p = env.getFunction("mix");
     ASSERT_NE(p, nullptr);
     EXPECT_EQ(p->parameterTypes.size(), 2u);
     EXPECT_EQ(p->parameterTypes[0], VarType::INT);
     EXPECT_EQ(p->parameterTypes[1], VarType::DOUBLE);
 }
+
+// Copies share their tables until one side writes.
+TEST(EnvironmentTest, CopyIsCopyOnWrite) {
+    Environment original;
+    original.define("x", VarType::INT, 1);
+    Function f;
+    f.returnType = VarType::INT;
+    original.defineFunction("f", f);
+
+    Environment fork(original);
+    EXPECT_TRUE(fork.sharesVariablesWith(original));
+    EXPECT_TRUE(fork.sharesFunctionsWith(original));
+
+    fork.assign("x", VarType::INT, 2);
+    EXPECT_FALSE(fork.sharesVariablesWith(original));
+    EXPECT_TRUE(fork.sharesFunctionsWith(original));
+    EXPECT_EQ(std::get<int>(fork.get("x").value), 2);
+    EXPECT_EQ(std::get<int>(original.get("x").value), 1);
+
+    original.defineFunction("g", f);
+    EXPECT_FALSE(fork.functionExists("g"));
+    EXPECT_EQ(fork.getFunction("f"), original.getFunction("f"));
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "EvaluationWorker.h"
+#include "Interpreter.h"
+#include "SpscQueue.h"
+#include "Utils.h"
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Polls the worker the way the render loop does, until a result arrives.
+std::optional<EvaluationWorker::Result> waitForResult(EvaluationWorker &worker) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (auto result = worker.poll()) {
+            return result;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+TEST(SpscQueueTest, PreservesOrderAcrossThreads) {
+    SpscQueue<int, 8> queue;
+    const int count = 100000;
+    std::thread producer([&] {
+        for (int i = 0; i < count; ++i) {
+            int value = i;
+            while (!queue.push(std::move(value))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (int expected = 0; expected < count;) {
+        if (auto value = queue.pop()) {
+            ASSERT_EQ(*value, expected);
+            ++expected;
+        }
+    }
+    producer.join();
+    EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST(SpscQueueTest, ReportsFull) {
+    SpscQueue<int, 4> queue;
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_TRUE(queue.push(3));
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_EQ(queue.pop(), 1);
+    EXPECT_TRUE(queue.push(4));
+}
+
+TEST(EvaluationWorkerTest, DeliversResults) {
+    EvaluationWorker worker;
+    Interpreter interpreter;
+    interpreter.setExecutionControl(&worker.control());
+
+    ASSERT_TRUE(worker.submit(EvaluationWorker::Target::Repl,
+                              [&] { return anyToString(interpreter.evaluate("6 * 7;", false)); }));
+    auto result = waitForResult(worker);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->target, EvaluationWorker::Target::Repl);
+    EXPECT_EQ(result->text, "42");
+    EXPECT_FALSE(worker.busy());
+}
+
+TEST(EvaluationWorkerTest, CancelStopsInfiniteLoop) {
+    EvaluationWorker worker;
+    Interpreter interpreter;
+    interpreter.setExecutionControl(&worker.control());
+    interpreter.evaluate("int spins = 0;", false);
+
+    ASSERT_TRUE(worker.submit(EvaluationWorker::Target::File, [&] {
+        return anyToString(interpreter.evaluate("while (1) { spins = spins + 1; }", false));
+    }));
+    EXPECT_FALSE(worker.submit(EvaluationWorker::Target::File, [] { return std::string("second"); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(worker.busy());
+    worker.cancel();
+
+    auto result = waitForResult(worker);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->text, "Error: Evaluation cancelled");
+
+    // The interpreter is still usable, with the loop's side effects kept.
+    EXPECT_GT(std::any_cast<int>(interpreter.evaluate("spins;", false)), 0);
+    ASSERT_TRUE(worker.submit(EvaluationWorker::Target::Repl,
+                              [&] { return anyToString(interpreter.evaluate("1 + 1;", false)); }));
+    result = waitForResult(worker);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->text, "2");
+}
+
+TEST(EvaluationWorkerTest, CancelStopsRunawayRecursionAndForLoops) {
+    EvaluationWorker worker;
+    Interpreter interpreter;
+    interpreter.setExecutionControl(&worker.control());
+    interpreter.evaluate("int forever(int n) { int i; for (i = 0; i < 1; i = i) { n = n + 1; } return n; }", false);
+
+    ASSERT_TRUE(worker.submit(EvaluationWorker::Target::Repl,
+                              [&] { return anyToString(interpreter.evaluate("forever(0);", false)); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    worker.cancel();
+    auto result = waitForResult(worker);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->text, "Error: Evaluation cancelled");
+}
+
+TEST(EvaluationWorkerTest, ResultListenerRunsAfterEachResult) {
+    EvaluationWorker worker;
+    std::atomic<int> notified{0};
+    worker.setResultListener([&] { notified.fetch_add(1); });
+
+    ASSERT_TRUE(worker.submit(EvaluationWorker::Target::Repl, [] { return std::string("done"); }));
+    auto result = waitForResult(worker);
+    ASSERT_TRUE(result.has_value());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (notified.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(notified.load(), 1);
+}
@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include <any>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Runs `code` in REPL mode and returns which limit stopped it.
+BudgetExceeded::Limit exceededLimit(Interpreter &interpreter, const char *code, const ExecutionBudget &budget) {
+    try {
+        interpreter.evaluate(code, false, budget);
+    } catch (const BudgetExceeded &e) {
+        return e.limit();
+    }
+    ADD_FAILURE() << "budget was not exceeded";
+    return BudgetExceeded::Limit::Steps;
+}
+
+} // namespace
+
+TEST(ExecutionBudgetTest, StepLimitStopsInfiniteLoop) {
+    Interpreter interpreter;
+    interpreter.evaluate("int n = 0;", false);
+    ExecutionBudget budget;
+    budget.maxSteps = 1000;
+    EXPECT_EQ(exceededLimit(interpreter, "while (1) { n = n + 1; }", budget), BudgetExceeded::Limit::Steps);
+    // Every iteration costs one step, charged before its body runs.
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("n;", false)), 1000);
+}
+
+TEST(ExecutionBudgetTest, CallDepthLimitStopsRunawayRecursion) {
+    Interpreter interpreter;
+    interpreter.evaluate("int down(int n) { return down(n + 1); }", false);
+    ExecutionBudget budget;
+    budget.maxCallDepth = 50;
+    EXPECT_EQ(exceededLimit(interpreter, "down(0);", budget), BudgetExceeded::Limit::CallDepth);
+}
+
+TEST(ExecutionBudgetTest, TimeoutStopsInfiniteLoop) {
+    Interpreter interpreter;
+    ExecutionBudget budget;
+    budget.timeout = 50ms;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(exceededLimit(interpreter, "while (1) { }", budget), BudgetExceeded::Limit::Time);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+}
+
+TEST(ExecutionBudgetTest, ProgramsWithinBudgetRunNormally) {
+    Interpreter interpreter;
+    ExecutionBudget budget;
+    budget.maxSteps = 10000;
+    budget.maxCallDepth = 20;
+    budget.timeout = 10s;
+    const char *program =
+        "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+        "int main() { int i = 0; int sum = 0; while (i < 10) { sum = sum + fib(i); i = i + 1; } return sum; }\n";
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(program, true, budget)), 88);
+}
+
+TEST(ExecutionBudgetTest, BudgetAppliesPerEvaluation) {
+    Interpreter interpreter;
+    interpreter.evaluate("int i = 0;", false);
+    ExecutionBudget budget;
+    budget.maxSteps = 100;
+    for (int round = 0; round < 5; ++round) {
+        interpreter.evaluate("i = 0;", false);
+        EXPECT_NO_THROW(interpreter.evaluate("while (i < 90) { i = i + 1; }", false, budget));
+    }
+    // Without a budget, nothing is limited.
+    EXPECT_NO_THROW(interpreter.evaluate("while (i < 10000) { i = i + 1; }", false));
+}
+
+TEST(ExecutionBudgetTest, ExceededIsARuntimeError) {
+    Interpreter interpreter;
+    ExecutionBudget budget;
+    budget.maxSteps = 10;
+    EXPECT_THROW(interpreter.evaluate("while (1) { }", false, budget), std::runtime_error);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("1 + 1;", false)), 2);
+}
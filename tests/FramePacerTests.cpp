@@ -0,0 +1,48 @@
+#include "gtest/gtest.h"
+#include "FramePacer.h"
+
+// Draws frames until the pacer has nothing left to draw.
+static void settle(FramePacer &pacer, double &now) {
+    while (pacer.waitSeconds(false, now) >= 0.0) {
+        now += pacer.waitSeconds(false, now);
+        pacer.frameDrawn(now);
+    }
+}
+
+TEST(FramePacerTest, IdleUiWaitsIndefinitely) {
+    FramePacer pacer;
+    double now = 0.0;
+    settle(pacer, now);
+    EXPECT_LT(pacer.waitSeconds(false, now + 100.0), 0.0);
+}
+
+TEST(FramePacerTest, ActivityBuysSettleFrames) {
+    FramePacer pacer(0.0);
+    double now = 0.0;
+    settle(pacer, now);
+    pacer.noteActivity();
+    for (int i = 0; i < FramePacer::kSettleFrames; ++i) {
+        ASSERT_EQ(pacer.waitSeconds(false, now), 0.0);
+        pacer.frameDrawn(now);
+    }
+    EXPECT_LT(pacer.waitSeconds(false, now), 0.0);
+}
+
+TEST(FramePacerTest, BusyWorkerRefreshesPeriodically) {
+    FramePacer pacer;
+    double now = 0.0;
+    settle(pacer, now);
+    EXPECT_NEAR(pacer.waitSeconds(true, now), 1.0 / FramePacer::kBusyRefreshHz, 1e-9);
+    EXPECT_EQ(pacer.waitSeconds(true, now + 1.0), 0.0);
+}
+
+TEST(FramePacerTest, CapSpacesOutFrames) {
+    FramePacer pacer(50.0);
+    pacer.frameDrawn(1.0);
+    pacer.noteActivity();
+    EXPECT_NEAR(pacer.waitSeconds(false, 1.005), 0.015, 1e-9);
+    EXPECT_EQ(pacer.throttleSeconds(1.02), 0.0);
+
+    pacer.setMaxFps(0.0);
+    EXPECT_EQ(pacer.waitSeconds(false, 1.005), 0.0);
+}
@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include "Program.h"
+#include <stdexcept>
+
+namespace {
+
+const char *kRules =
+    "int threshold = 100;\n"
+    "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+    "double scale(int x, double factor) { return x * factor; }\n"
+    "char grade(int score) { if (score > threshold) { return 'A'; } return 'B'; }\n"
+    "int answer() { return 42; }\n";
+
+} // namespace
+
+TEST(FunctionHandleTest, CallsWithNativeArguments) {
+    Interpreter rules(Program::compile(kRules));
+    auto fib = rules.function<int(int)>("fib");
+    auto scale = rules.function<double(int, double)>("scale");
+    auto grade = rules.function<char(int)>("grade");
+    auto answer = rules.function<int()>("answer");
+
+    EXPECT_EQ(fib(10), 55);
+    EXPECT_DOUBLE_EQ(scale(3, 0.5), 1.5);
+    EXPECT_EQ(grade(150), 'A');
+    EXPECT_EQ(grade(50), 'B');
+    EXPECT_EQ(answer(), 42);
+}
+
+TEST(FunctionHandleTest, RepeatedCallsSeeCurrentGlobals) {
+    Interpreter rules(Program::compile(kRules));
+    auto grade = rules.function<char(int)>("grade");
+    EXPECT_EQ(grade(80), 'B');
+    rules.evaluate("threshold = 50;", false);
+    EXPECT_EQ(grade(80), 'A');
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(grade(i), i > 50 ? 'A' : 'B');
+    }
+}
+
+TEST(FunctionHandleTest, WorksWithReplDefinedFunctions) {
+    Interpreter interpreter;
+    interpreter.evaluate("int add(int a, int b) { return a + b; }", false);
+    auto add = interpreter.function<int(int, int)>("add");
+    EXPECT_EQ(add(40, 2), 42);
+}
+
+TEST(FunctionHandleTest, HandleSurvivesRedefinition) {
+    Interpreter interpreter;
+    interpreter.evaluate("int f() { return 1; }", false);
+    auto oldF = interpreter.function<int()>("f");
+    interpreter.evaluate("int f() { return 2; }", false);
+    EXPECT_EQ(oldF(), 1);
+    EXPECT_EQ(interpreter.function<int()>("f")(), 2);
+}
+
+TEST(FunctionHandleTest, LookupChecksSignature) {
+    Interpreter rules(Program::compile(kRules));
+    EXPECT_THROW(rules.function<int(int)>("missing"), std::runtime_error);
+    EXPECT_THROW(rules.function<int(int, int)>("fib"), std::runtime_error);
+    EXPECT_THROW(rules.function<double(int)>("fib"), std::runtime_error);
+    EXPECT_THROW(rules.function<double(double, double)>("scale"), std::runtime_error);
+}
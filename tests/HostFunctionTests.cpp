@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include "AllocationAssertions.h"
+#include "HostFunction.h"
+#include "Interpreter.h"
+#include <any>
+#include <stdexcept>
+#include <vector>
+
+TEST(HostFunctionTest, ScriptsCallHostFunctions) {
+    Interpreter interpreter;
+    interpreter.defineFunction<double(int, double)>("scale", [](int x, double factor) { return x * factor; });
+    interpreter.defineFunction<char(int)>("letter", [](int i) { return static_cast<char>('a' + i); });
+    interpreter.defineFunction<int()>("answer", [] { return 42; });
+
+    EXPECT_DOUBLE_EQ(std::any_cast<double>(interpreter.evaluate("scale(3, 0.5);", false)), 1.5);
+    EXPECT_EQ(std::any_cast<char>(interpreter.evaluate("letter(2);", false)), 'c');
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("answer() + 1;", false)), 43);
+    interpreter.evaluate("int twice(int x) { return 2 * answer() + x; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("twice(1);", false)), 85);
+}
+
+TEST(HostFunctionTest, ArgumentsAndResultsAreConverted) {
+    Interpreter interpreter;
+    interpreter.defineFunction<double(double)>("half", [](double x) { return x / 2; });
+    interpreter.defineFunction<int(int)>("truncated", [](int x) { return x; });
+    // A callable returning another arithmetic type is converted at compile time.
+    interpreter.defineFunction<int(double)>("rounded", [](double x) { return x + 0.5; });
+
+    EXPECT_DOUBLE_EQ(std::any_cast<double>(interpreter.evaluate("half(3);", false)), 1.5);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("truncated(2.9);", false)), 2);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("truncated('A');", false)), 65);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("rounded(1.6);", false)), 2);
+}
+
+TEST(HostFunctionTest, CallsKeepTheirSideEffects) {
+    int counter = 0;
+    Interpreter interpreter;
+    interpreter.defineFunction<int()>("next", [&counter] { return ++counter; });
+    interpreter.evaluate("int sum(int n) {\n"
+                         "    int i = 0; int s = 0;\n"
+                         "    while (i < n) { s = s + next() * 0 + next(); i = i + 1; }\n"
+                         "    return s;\n"
+                         "}\n",
+                         false);
+    // Neither hoisted out of the loop nor reused within the statement.
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("sum(3);", false)), 2 + 4 + 6);
+    EXPECT_EQ(counter, 6);
+}
+
+TEST(HostFunctionTest, ArityIsCheckedAtTheCall) {
+    Interpreter interpreter;
+    interpreter.defineFunction<int(int, int)>("add", [](int a, int b) { return a + b; });
+    EXPECT_THROW(interpreter.evaluate("add(1);", false), std::runtime_error);
+    EXPECT_THROW(interpreter.evaluate("add(1, 2, 3);", false), std::runtime_error);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("add(1, 2);", false)), 3);
+}
+
+TEST(HostFunctionTest, FollowsFunctionDefinitionRules) {
+    Interpreter interpreter;
+    EXPECT_THROW(interpreter.defineFunction<int(int)>("putchar", [](int c) { return c; }), std::runtime_error);
+
+    interpreter.defineFunction<int()>("version", [] { return 1; });
+    auto snapshot = interpreter.snapshot();
+    interpreter.evaluate("int version() { return 2; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("version();", false)), 2);
+    Interpreter fork(snapshot);
+    EXPECT_EQ(std::any_cast<int>(fork.evaluate("version();", false)), 1);
+
+    // Handles work on host functions too.
+    auto version = fork.function<int()>("version");
+    EXPECT_EQ(version(), 1);
+    EXPECT_THROW(fork.function<double()>("version"), std::runtime_error);
+}
+
+TEST(HostFunctionTest, TrampolineAllocatesNothing) {
+    auto step = HostFunction<int(int, double)>::make([](int x, double d) { return x + d; });
+    EXPECT_EQ(step->parameterTypes, (std::vector<VarType>{VarType::INT, VarType::DOUBLE}));
+    EXPECT_EQ(step->returnType, VarType::INT);
+    const VarValue args[] = {VarValue(1), VarValue(0.5)};
+    EXPECT_TRUE(allocatesNothing([&] { step->host(args); }));
+}
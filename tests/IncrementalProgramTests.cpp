@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include "IncrementalProgram.h"
+#include "Interpreter.h"
+#include <any>
+#include <string>
+
+// Helper: run the program's current parse with a fresh interpreter.
+static int runMain(const IncrementalProgram &program) {
+    Interpreter interpreter;
+    return std::any_cast<int>(interpreter.runProgram(program.units()));
+}
+
+TEST(IncrementalProgramTest, SplitsTopLevelDeclarations) {
+    IncrementalProgram program;
+    program.update("int x = 40; int add(int a, int b) { return a + b; } int main() { return add(x, 2); }");
+    EXPECT_FALSE(program.hasErrors());
+    EXPECT_EQ(program.declarationCount(), 3u);
+    EXPECT_EQ(program.lastReparseCount(), 3u);
+    EXPECT_EQ(runMain(program), 42);
+}
+
+TEST(IncrementalProgramTest, OnlyChangedFunctionIsReparsed) {
+    IncrementalProgram program;
+    program.update("int f() { return 1; }\nint g() { return 2; }\nint main() { return f() + g(); }");
+    ASSERT_EQ(runMain(program), 3);
+
+    program.update("int f() { return 1; }\nint g() { return 20; }\nint main() { return f() + g(); }");
+    EXPECT_EQ(program.lastReparseCount(), 1u);
+    EXPECT_EQ(runMain(program), 21);
+}
+
+TEST(IncrementalProgramTest, WhitespaceBetweenDeclarationsIsReused) {
+    IncrementalProgram program;
+    program.update("int f() { return 1; } int main() { return f(); }");
+    program.update("int f() { return 1; }\n\n\nint main() { return f(); }\n");
+    EXPECT_EQ(program.lastReparseCount(), 0u);
+    EXPECT_EQ(runMain(program), 1);
+}
+
+TEST(IncrementalProgramTest, BracesInCommentsDoNotSplit) {
+    IncrementalProgram program;
+    program.update("int main() { /* } */ int a = 5; // }\n return a; }");
+    EXPECT_FALSE(program.hasErrors());
+    EXPECT_EQ(program.declarationCount(), 1u);
+    EXPECT_EQ(runMain(program), 5);
+}
+
+TEST(IncrementalProgramTest, BracesInStringsDoNotSplit) {
+    IncrementalProgram program;
+    program.update("int main() { printf(\"} \\\" { // \\\\\"); return 7; }\nint g() { return 1; }");
+    EXPECT_FALSE(program.hasErrors());
+    EXPECT_EQ(program.declarationCount(), 2u);
+    EXPECT_EQ(runMain(program), 7);
+}
+
+TEST(IncrementalProgramTest, SyntaxErrorReportedWithSourceLine) {
+    IncrementalProgram program;
+    program.update("int f() { return 1; }\nint main() { return 1 + ; }");
+    ASSERT_TRUE(program.hasErrors());
+    auto errors = program.errors();
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_NE(errors[0].find("line 2"), std::string::npos);
+
+    // Fixing the error reparses just that declaration.
+    program.update("int f() { return 1; }\nint main() { return 1 + f(); }");
+    EXPECT_FALSE(program.hasErrors());
+    EXPECT_EQ(program.lastReparseCount(), 1u);
+    EXPECT_EQ(runMain(program), 2);
+}
+
+TEST(IncrementalProgramTest, UnterminatedDeclarationIsAnError) {
+    IncrementalProgram program;
+    program.update("int main() { return 0; }\nint f() { return");
+    EXPECT_TRUE(program.hasErrors());
+    EXPECT_EQ(program.errors().size(), 1u);
+}
+
+TEST(IncrementalProgramTest, EmptySourceHasNoMain) {
+    IncrementalProgram program;
+    program.update("");
+    EXPECT_FALSE(program.hasErrors());
+    Interpreter interpreter;
+    EXPECT_THROW(interpreter.runProgram(program.units()), std::runtime_error);
+}
+
+// A generated program well past the old 16 KiB editor limit.
+TEST(IncrementalProgramTest, LargeProgramEditReparsesOneDeclaration) {
+    std::string source;
+    for (int i = 0; i < 2000; ++i) {
+        source += "int f" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+    }
+    source += "int main() { return f1999() - f1; }\n";
+    IncrementalProgram program;
+    program.update(source);
+    ASSERT_GT(source.size(), 16u * 1024);
+    EXPECT_EQ(program.declarationCount(), 2001u);
+    EXPECT_EQ(runMain(program), 1998);
+
+    source.replace(source.find("return 1;"), 9, "return 8;");
+    program.update(source);
+    EXPECT_EQ(program.lastReparseCount(), 1u);
+    EXPECT_EQ(runMain(program), 1991);
+}
@@ -1,7 +1,9 @@
 #include "gtest/gtest.h"
 #include "Interpreter.h"
+#include "AllocationTracker.h"
 #include <any>
 #include <stdexcept>
+#include <string>
 
 
 TEST(InterpreterTest, SimpleExpression) {
@@ -123,6 +125,15 @@ TEST(InterpreterTest, VariableDeclarationAndReference) {
     EXPECT_EQ(value, 15);
 }
 
+// Initialisers are converted to the declared type, as in C.
+TEST(InterpreterTest, DeclarationConvertsInitializer) {
+    Interpreter interpreter;
+    interpreter.evaluate("int i = 7 / 2.0; double d = 3; char c = 66;", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("i;", false)), 3);
+    EXPECT_EQ(std::any_cast<double>(interpreter.evaluate("d;", false)), 3.0);
+    EXPECT_EQ(std::any_cast<char>(interpreter.evaluate("c;", false)), 'B');
+}
+
 // Test persistent environment across multiple evaluations.
 // For example, after declaring a variable, it should be available in subsequent evaluations.
 TEST(InterpreterTest, PersistentEnvironment) {
@@ -135,6 +146,32 @@ TEST(InterpreterTest, PersistentEnvironment) {
     EXPECT_EQ(value, 15);
 }
 
+// REPL lines share one lexer/parser pipeline; functions keep the tree they
+// were parsed into even after later lines reuse the pipeline.
+TEST(InterpreterTest, ReusedParserKeepsFunctionBodiesIntact) {
+    Interpreter interpreter;
+    interpreter.evaluate("int base = 5;", false);
+    interpreter.evaluate("int addBase(int n) { return n + base; }", false);
+    for (int i = 0; i < 20; ++i) {
+        std::string line = "addBase(" + std::to_string(i) + ") * 2;";
+        EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(line, false)), (i + 5) * 2);
+    }
+    EXPECT_THROW(interpreter.evaluate("1 + ;", false), std::exception);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("addBase(1);", false)), 6);
+}
+
+TEST(InterpreterTest, ReusedParserAllocatesLessPerLine) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    Interpreter interpreter;
+    interpreter.evaluate("int x = 1;", false);
+    AllocationCounts first = interpreter.lastEvaluationAllocations().lex;
+    interpreter.evaluate("x = x + 1;", false);
+    interpreter.evaluate("x = x + 1;", false);
+    EXPECT_LT(interpreter.lastEvaluationAllocations().lex.allocations, first.allocations);
+}
+
 /*
  * Function Testing
  */
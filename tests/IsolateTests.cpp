@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include "Program.h"
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *kSource =
+    "int counter = 10;\n"
+    "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+    "int bump(int by) { counter = counter + by; return counter; }\n"
+    "int main() { return fib(10) + counter; }\n";
+
+} // namespace
+
+TEST(IsolateTest, IsolatesShareFunctionsButNotGlobals) {
+    auto program = Program::compile(kSource);
+    Interpreter a(program);
+    Interpreter b(program);
+
+    EXPECT_EQ(std::any_cast<int>(a.evaluate("bump(5);", false)), 15);
+    EXPECT_EQ(std::any_cast<int>(a.run()), 70);
+    EXPECT_EQ(std::any_cast<int>(b.run()), 65);
+}
+
+TEST(IsolateTest, ReplDefinitionsStayInTheirIsolate) {
+    auto program = Program::compile(kSource);
+    Interpreter a(program);
+    Interpreter b(program);
+
+    a.evaluate("int twice(int x) { return x * 2; }", false);
+    EXPECT_EQ(std::any_cast<int>(a.evaluate("twice(21);", false)), 42);
+    EXPECT_THROW(b.evaluate("twice(21);", false), std::runtime_error);
+}
+
+TEST(IsolateTest, ProgramOutlivesItsCreator) {
+    std::unique_ptr<Interpreter> isolate;
+    {
+        auto program = Program::compile(kSource);
+        isolate = std::make_unique<Interpreter>(program);
+    }
+    EXPECT_EQ(std::any_cast<int>(isolate->run()), 65);
+}
+
+TEST(IsolateTest, CompileReportsSyntaxErrors) {
+    EXPECT_THROW(Program::compile("int main() { return 1 }"), std::runtime_error);
+}
+
+// Many threads, each creating isolates of one shared program and mutating
+// their own globals. Build with -DVCI_ENABLE_TSAN=ON to check for races.
+TEST(IsolateTest, ConcurrentIsolatesStress) {
+    auto program = Program::compile(kSource);
+    const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+    const int isolatesPerThread = 50;
+    const int evaluationsPerIsolate = 20;
+
+    std::atomic<int> failures{0};
+    std::atomic<int> evaluations{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < isolatesPerThread; ++i) {
+                Interpreter isolate(program);
+                int expected = 10;
+                for (int e = 0; e < evaluationsPerIsolate; ++e) {
+                    int by = static_cast<int>(t) + e;
+                    expected += by;
+                    auto bumped = std::any_cast<int>(isolate.evaluate("bump(" + std::to_string(by) + ");", false));
+                    if (bumped != expected) {
+                        ++failures;
+                    }
+                    ++evaluations;
+                }
+                if (std::any_cast<int>(isolate.run()) != 55 + expected) {
+                    ++failures;
+                }
+                ++evaluations;
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(evaluations.load(), static_cast<int>(threads) * isolatesPerThread * (evaluationsPerIsolate + 1));
+}
+
+TEST(IsolateTest, ForkedSessionsDivergeFromSnapshot) {
+    Interpreter base;
+    base.evaluate("int total = 1;", false);
+    base.evaluate("int scale(int x) { return x * 10; }", false);
+    auto prelude = base.snapshot();
+
+    Interpreter trial(prelude);
+    trial.evaluate("total = scale(total) + 5;", false);
+    trial.evaluate("int extra = 2;", false);
+    EXPECT_EQ(std::any_cast<int>(trial.evaluate("total + extra;", false)), 17);
+
+    base.evaluate("total = 100;", false);
+    Interpreter other(prelude);
+    EXPECT_EQ(std::any_cast<int>(other.evaluate("scale(total);", false)), 10);
+    EXPECT_THROW(other.evaluate("extra;", false), std::runtime_error);
+    EXPECT_EQ(std::any_cast<int>(base.evaluate("total;", false)), 100);
+}
+
+TEST(IsolateTest, ForksFromOneSnapshotRunConcurrently) {
+    Interpreter base;
+    base.evaluate("int counter = 0;", false);
+    base.evaluate("int bump(int by) { counter = counter + by; return counter; }", false);
+    auto prelude = base.snapshot();
+
+    std::vector<int> results(8);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            Interpreter session(prelude);
+            for (int i = 0; i < 100; ++i) {
+                results[t] = std::any_cast<int>(session.evaluate("bump(" + std::to_string(t + 1) + ");", false));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < 8; ++t) {
+        EXPECT_EQ(results[t], 100 * (t + 1));
+    }
+}
+
+// The fork is the last other owner of the base's tables and goes away on its
+// own thread. The base learns that only through the relaxed flag, the way it
+// would in a server, then writes the tables in place; writable()'s fence is
+// what orders the fork's reads before those writes.
+TEST(IsolateTest, BaseWritesInPlaceAfterForkEndsOnAnotherThread) {
+    for (int round = 0; round < 100; ++round) {
+        Interpreter base;
+        base.evaluate("int total = 1;", false);
+        std::atomic<bool> forkDone{false};
+        std::thread fork([&forkDone, prelude = base.snapshot()]() mutable {
+            {
+                Interpreter session(prelude);
+                prelude.reset();
+                EXPECT_EQ(std::any_cast<int>(session.evaluate("total + 1;", false)), 2);
+            }
+            forkDone.store(true, std::memory_order_relaxed);
+        });
+        while (!forkDone.load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+        }
+        base.evaluate("total = total + 5;", false);
+        EXPECT_EQ(std::any_cast<int>(base.evaluate("total;", false)), 6);
+        fork.join();
+    }
+}
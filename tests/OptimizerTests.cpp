@@ -0,0 +1,314 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include "Optimizer.h"
+#include "ParseUnit.h"
+#include <algorithm>
+#include <any>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+OptimizerOptions allOff() {
+    OptimizerOptions options;
+    options.hoistLoopInvariants = false;
+    options.eliminateCommonSubexpressions = false;
+    options.inlineSmallFunctions = false;
+    return options;
+}
+
+// Evaluates code in a fresh interpreter with and without optimizations and
+// expects the same int from both; returns it.
+int sameBothWays(const std::string &code, bool isFileMode) {
+    Interpreter optimized;
+    Interpreter plain;
+    plain.setOptimizerOptions(allOff());
+    int expected = std::any_cast<int>(plain.evaluate(code, isFileMode));
+    EXPECT_EQ(std::any_cast<int>(optimized.evaluate(code, isFileMode)), expected) << code;
+    return expected;
+}
+
+// How many times `program` calls `function`.
+uint64_t callsTo(const std::string &program, const std::string &function, const OptimizerOptions &options) {
+    Interpreter interpreter;
+    interpreter.setOptimizerOptions(options);
+    interpreter.enableProfiling(true);
+    interpreter.evaluate(program, true);
+    const auto &functions = interpreter.profiler()->functions();
+    auto it = functions.find(function);
+    return it == functions.end() ? 0 : it->second.calls;
+}
+
+const antlr4::ParserRuleContext *firstLoop(antlr4::tree::ParseTree *node) {
+    if (dynamic_cast<CParser::WhileStatementContext *>(node) ||
+        dynamic_cast<CParser::DoWhileStatementContext *>(node) ||
+        dynamic_cast<CParser::ForStatementContext *>(node)) {
+        return static_cast<antlr4::ParserRuleContext *>(node);
+    }
+    for (auto *child : node->children) {
+        if (const auto *loop = firstLoop(child)) {
+            return loop;
+        }
+    }
+    return nullptr;
+}
+
+// Source text (without spaces) of the invariants of the first loop in code.
+std::vector<std::string> invariantsOf(const std::string &code) {
+    ParseUnit unit(code);
+    const auto *loop = firstLoop(unit.parseReplInput());
+    const LoopPlan *plan = loop ? unit.optimizationPlan()->loop(loop) : nullptr;
+    std::vector<std::string> texts;
+    if (plan) {
+        for (const auto &invariant : plan->invariants) {
+            texts.push_back(unit.tokenStream()->getText(invariant.node->getStart(), invariant.node->getStop()));
+        }
+    }
+    std::sort(texts.begin(), texts.end());
+    return texts;
+}
+
+// Source text (without spaces) of the repeated operations in a REPL line.
+std::vector<std::string> repeatsOf(const std::string &code) {
+    ParseUnit unit(code);
+    const BlockPlan *plan = unit.optimizationPlan()->block(unit.parseReplInput());
+    std::vector<std::string> texts;
+    if (plan) {
+        for (const auto &repeat : plan->repeats) {
+            texts.push_back(unit.tokenStream()->getText(repeat.repeat->getStart(), repeat.repeat->getStop()));
+        }
+    }
+    std::sort(texts.begin(), texts.end());
+    return texts;
+}
+
+// A function with parameter x and this body.
+std::shared_ptr<const Function> compiled(const std::string &body) {
+    Function func;
+    func.returnType = VarType::INT;
+    func.parameterTypes = {VarType::INT};
+    func.parameterNames = {"x"};
+    func.bodyText = body;
+    return compileFunction(std::move(func));
+}
+
+// Whether a function with parameter x and this body can be inlined.
+bool inlinable(const std::string &body) {
+    return compiled(body)->compiled().inlineBody.has_value();
+}
+
+} // namespace
+
+TEST(OptimizerTest, FindsInvariantsInLoopConditionAndBody) {
+    EXPECT_EQ(invariantsOf("while (i < n * m + k) { s = s + n * 2; i = i + 1; }"),
+              (std::vector<std::string>{"n*2", "n*m", "n*m+k"}));
+    EXPECT_EQ(invariantsOf("for (i = a + b; i < 10; i = i + 1) { s = s + i * c; }"),
+              std::vector<std::string>{}); // the initialiser runs once anyway
+    EXPECT_EQ(invariantsOf("do { s = s - -k; } while (s < f(k));"),
+              (std::vector<std::string>{"-k", "f(k)"}));
+}
+
+TEST(OptimizerTest, AnythingTheLoopWritesIsNotInvariant) {
+    EXPECT_TRUE(invariantsOf("while (i < 10) { n = n + 1; x = n * 2; i = i + 1; }").empty());
+    EXPECT_TRUE(invariantsOf("while (i < 10) { int t = 3; x = t * 2; i = i + 1; }").empty());
+    EXPECT_TRUE(invariantsOf("while (i < 10) { x = (y = 2) * 3; i = i + 1; }").empty());
+}
+
+TEST(OptimizerTest, HoistedLoopsComputeTheSameResults) {
+    EXPECT_EQ(sameBothWays("int n = 3; int m = 4; int k = 5; int i = 0; int s = 0;"
+                           "while (i < n * m + k) { s = s + n * 2; i = i + 1; } s;", false), 102);
+    EXPECT_EQ(sameBothWays("double d = 0.5; int i = 0; double s = 0.0;"
+                           "for (i = 0; i < 4; i = i + 1) { s = s + d * 3; } i;", false), 4);
+    // The inner loop's invariant depends on the outer loop's counter.
+    EXPECT_EQ(sameBothWays("int s = 0; int i; int j;"
+                           "for (i = 0; i < 3; i = i + 1) { for (j = 0; j < 2; j = j + 1) { s = s + i * 10; } } s;",
+                           false), 60);
+}
+
+TEST(OptimizerTest, LoopsThatRunZeroTimesEvaluateNothing) {
+    EXPECT_EQ(sameBothWays("int z = 0; int s = 0; while (s > 0) { s = s + 10 / z; } s;", false), 0);
+    EXPECT_EQ(sameBothWays("int z = 0; int s = 0; int i; for (i = 0; i < 0; i = i + 1) { s = s + 10 / z; } s;", false), 0);
+}
+
+TEST(OptimizerTest, FailingInvariantsFailWhereTheyDidBefore) {
+    for (const OptimizerOptions &options : {OptimizerOptions{}, allOff()}) {
+        Interpreter interpreter;
+        interpreter.setOptimizerOptions(options);
+        interpreter.evaluate("int z = 0; int s = 0;", false);
+        EXPECT_THROW(interpreter.evaluate("while (s < 5) { s = s + 1; s = s + 1 / z; }", false), std::runtime_error);
+        EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("s;", false)), 1);
+    }
+}
+
+TEST(OptimizerTest, PureCallsRunOncePerLoop) {
+    const std::string program =
+        "int square(int x) { int r = x * x; return r; }\n"
+        "int main() { int k = 7; int s = 0; int i; for (i = 0; i < 10; i = i + 1) { s = s + square(k); } return s; }\n";
+    EXPECT_EQ(sameBothWays(program, true), 490);
+    EXPECT_EQ(callsTo(program, "square", OptimizerOptions{}), 1u);
+    EXPECT_EQ(callsTo(program, "square", allOff()), 10u);
+}
+
+TEST(OptimizerTest, CallsWithSideEffectsAreNotHoisted) {
+    const std::string program =
+        "int counter = 0;\n"
+        "int next() { counter = counter + 1; return counter; }\n"
+        "int twice() { return next() * 2; }\n"
+        "int main() { int s = 0; int i; for (i = 0; i < 5; i = i + 1) { s = s + twice(); } return s; }\n";
+    EXPECT_EQ(sameBothWays(program, true), 30);
+    EXPECT_EQ(callsTo(program, "twice", OptimizerOptions{}), 5u);
+}
+
+TEST(OptimizerTest, CallsReadingGlobalsTheLoopChangesAreNotHoisted) {
+    const std::string functions =
+        "int g = 1;\n"
+        "int readG() { return g * 10; }\n"
+        "int bump() { g = g + 1; return 0; }\n";
+    EXPECT_EQ(sameBothWays(functions +
+                           "int main() { int s = 0; int i; for (i = 0; i < 3; i = i + 1) { s = s + readG(); g = g + 1; } return s; }\n",
+                           true), 60);
+    EXPECT_EQ(sameBothWays(functions +
+                           "int main() { int s = 0; int i; for (i = 0; i < 3; i = i + 1) { s = s + readG(); bump(); } return s; }\n",
+                           true), 60);
+}
+
+TEST(OptimizerTest, RecursiveCallsKeepTheirOwnInvariants) {
+    const std::string program =
+        "int f(int n) { int s = 0; int i;\n"
+        "    for (i = 0; i < 2; i = i + 1) { if (n > 0) { s = s + f(n - 1); } s = s + n * 100; }\n"
+        "    return s; }\n"
+        "int main() { return f(2); }\n";
+    EXPECT_EQ(sameBothWays(program, true), 800);
+}
+
+TEST(OptimizerTest, PurityFollowsRedefinitions) {
+    Interpreter interpreter;
+    interpreter.evaluate("int c = 0; int h() { return 1; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(
+        "int s = 0; int i; for (i = 0; i < 3; i = i + 1) { s = s + h(); } s;", false)), 3);
+    interpreter.evaluate("int h() { c = c + 1; return c; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(
+        "s = 0; for (i = 0; i < 3; i = i + 1) { s = s + h(); } s;", false)), 6);
+}
+
+TEST(OptimizerTest, FindsRepeatsInStraightLineCode) {
+    EXPECT_EQ(repeatsOf("x = a * b + c; y = a * b - c;"), std::vector<std::string>{"a*b"});
+    EXPECT_EQ(repeatsOf("x = (a + b) * (a + b);"), std::vector<std::string>{"a+b"});
+    EXPECT_EQ(repeatsOf("x = a * b; y = a * b; z = a * b;"), (std::vector<std::string>{"a*b", "a*b"}));
+    EXPECT_EQ(repeatsOf("int x = a * b; int y = a * b;"), std::vector<std::string>{"a*b"});
+}
+
+TEST(OptimizerTest, AssignmentsCallsAndBranchesEndRepeats) {
+    EXPECT_TRUE(repeatsOf("x = a * b; a = 1; y = a * b;").empty());
+    EXPECT_TRUE(repeatsOf("x = a * b; int a = 2; y = a * b;").empty());
+    EXPECT_TRUE(repeatsOf("x = a * b + (a = 1); y = a * b;").empty());
+    EXPECT_TRUE(repeatsOf("x = f(a) + 1; y = f(a) + 1;").empty());
+    EXPECT_TRUE(repeatsOf("x = a * b; if (x) { y = 1; } y = a * b;").empty());
+    EXPECT_TRUE(repeatsOf("x = a * b; while (x) { x = x - 1; } y = a * b;").empty());
+    // Unrelated assignments leave it alone.
+    EXPECT_EQ(repeatsOf("x = a * b; c = 1; y = a * b;"), std::vector<std::string>{"a*b"});
+}
+
+TEST(OptimizerTest, RepeatsComputeTheSameResults) {
+    EXPECT_EQ(sameBothWays("int a = 3; int b = 4; int x = a * b + 1; int y = a * b - 1;"
+                           "a = a + 1; int z = a * b; x + y + z;", false), 40);
+    EXPECT_EQ(sameBothWays("int main() { int a = 5; int b = (a - 1) * (a - 1); { int a = 2; b = b + (a - 1); }"
+                           "return b + (a - 1); }", true), 21);
+    // Invariants and repeats in the same loop body.
+    EXPECT_EQ(sameBothWays("int s = 0; int i; int n = 3;"
+                           "for (i = 0; i < 3; i = i + 1) { s = s + n * 2; s = s + n * 2; } s;", false), 36);
+}
+
+TEST(OptimizerTest, CallsBetweenRepeatsAreChecked) {
+    const std::string functions =
+        "int g = 2;\n"
+        "int bump() { g = g + 1; return 0; }\n"
+        "int nothing() { return g; }\n";
+    EXPECT_EQ(sameBothWays(functions + "int main() { int a = g * 3; bump(); int b = g * 3; return a + b; }\n", true), 15);
+    EXPECT_EQ(sameBothWays(functions + "int main() { int a = g * 3 + bump(); int b = g * 3; return a + b; }\n", true), 15);
+    EXPECT_EQ(sameBothWays(functions + "int main() { int a = g * 3; nothing(); int b = g * 3; return a + b; }\n", true), 12);
+}
+
+TEST(OptimizerTest, RepeatsFollowRedefinitions) {
+    Interpreter interpreter;
+    interpreter.evaluate("int g = 1; int a; int b; int f() { return 0; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("a = g * 5; f(); b = g * 5; a + b;", false)), 10);
+    interpreter.evaluate("int f() { g = g + 1; return 0; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("a = g * 5; f(); b = g * 5; a + b;", false)), 15);
+}
+
+TEST(OptimizerTest, InlinesSmallStraightLineBodies) {
+    EXPECT_TRUE(inlinable("{ return x * x; }"));
+    EXPECT_TRUE(inlinable("{ int y = x + 1; y = y * 2; return y; }"));
+    EXPECT_FALSE(inlinable("{ x = x + 1; }"));                    // no return
+    EXPECT_FALSE(inlinable("{ int x = 2; return x; }"));          // shadows a parameter
+    EXPECT_FALSE(inlinable("{ int y = 1; int y = 2; return y; }"));
+    EXPECT_FALSE(inlinable("{ if (x) { return 1; } return 0; }"));
+    EXPECT_FALSE(inlinable("{ while (x > 0) { x = x - 1; } return x; }"));
+    EXPECT_FALSE(inlinable("{ return x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x"
+                           " + x + x + x + x + x + x + x + x + x + x; }"));
+}
+
+TEST(OptimizerTest, InlinedCallsComputeTheSameResults) {
+    // Arguments and results are converted to the declared types.
+    EXPECT_EQ(sameBothWays("int toInt(double d) { return d; }\n"
+                           "double half(int x) { return x / 2; }\n"
+                           "int main() { return toInt(half(7.9) * 10); }\n", true), 30);
+    // Callees see the caller's variables, as with a normal call.
+    EXPECT_EQ(sameBothWays("int k = 10;\n"
+                           "int addK(int x) { return x + k; }\n"
+                           "int main() { int k = 1; return addK(2); }\n", true), 3);
+    // Deeper than kMaxInlineDepth, and recursion, which is never inlined.
+    EXPECT_EQ(sameBothWays("int f1(int x) { return x + 1; }\n"
+                           "int f2(int x) { return f1(x) + 1; }\n"
+                           "int f3(int x) { return f2(x) + 1; }\n"
+                           "int f4(int x) { return f3(x) + 1; }\n"
+                           "int f5(int x) { return f4(x) + 1; }\n"
+                           "int f6(int x) { return f5(x) + 1; }\n"
+                           "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+                           "int main() { return f6(0) + fib(10); }\n", true), 61);
+}
+
+TEST(OptimizerTest, SelfRecursiveFunctionsAreNotInlined) {
+    // The body alone qualifies; only its call to itself keeps it a real call,
+    // so the recursion is bounded by the call depth budget as usual.
+    auto f = compiled("{ return f(x); }");
+    ASSERT_TRUE(f->compiled().inlineBody.has_value());
+    EXPECT_TRUE(std::ranges::binary_search(f->compiled().effects.callees, std::string("f")));
+
+    ExecutionBudget budget;
+    budget.maxCallDepth = 100;
+    for (bool inlining : {true, false}) {
+        OptimizerOptions options;
+        options.inlineSmallFunctions = inlining;
+        Interpreter interpreter;
+        interpreter.setOptimizerOptions(options);
+        interpreter.evaluate("int f(int x) { return f(x); }", false);
+        try {
+            interpreter.evaluate("f(1);", false, budget);
+            ADD_FAILURE() << "budget was not exceeded";
+        } catch (const BudgetExceeded &e) {
+            EXPECT_EQ(e.limit(), BudgetExceeded::Limit::CallDepth);
+        }
+    }
+}
+
+TEST(OptimizerTest, InlinedLocalsStayLocal) {
+    Interpreter interpreter;
+    interpreter.evaluate("int y = 5; int f(int x) { int y = x * 2; return y + 1; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("f(3);", false)), 7);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("y;", false)), 5);
+    EXPECT_THROW(interpreter.evaluate("f(1, 2);", false), std::runtime_error);
+}
+
+TEST(OptimizerTest, InliningFollowsRedefinitions) {
+    Interpreter interpreter;
+    interpreter.evaluate("int sq(int x) { return x * x; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("sq(3);", false)), 9);
+    interpreter.evaluate("int sq(int x) { return x + x; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("sq(3);", false)), 6);
+    interpreter.evaluate("int sq(int x) { if (x > 2) { return 1; } return 0; }", false);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate("sq(3);", false)), 1);
+}
@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+#include "OutputLog.h"
+#include <string>
+
+TEST(OutputLogTest, SplitsAppendedTextIntoLines) {
+    OutputLog log;
+    log.append("> 1 + 1;\n2\n");
+    log.append("> 3");
+    log.append(" * 3;\n");
+    ASSERT_EQ(log.lineCount(), 3u);
+    EXPECT_EQ(log.line(0), "> 1 + 1;");
+    EXPECT_EQ(log.line(1), "2");
+    EXPECT_EQ(log.line(2), "> 3 * 3;");
+}
+
+TEST(OutputLogTest, UnfinishedLineIsShown) {
+    OutputLog log;
+    log.append("File Result:\n");
+    log.append("Running");
+    ASSERT_EQ(log.lineCount(), 2u);
+    EXPECT_EQ(log.line(1), "Running");
+    log.append("\n\n");
+    ASSERT_EQ(log.lineCount(), 3u);
+    EXPECT_EQ(log.line(2), "");
+}
+
+TEST(OutputLogTest, KeepsOnlyTheNewestLines) {
+    OutputLog log(100);
+    for (int i = 0; i < 100000; ++i) {
+        log.append(std::to_string(i) + "\n");
+    }
+    ASSERT_EQ(log.lineCount(), 100u);
+    EXPECT_EQ(log.line(0), "99900");
+    EXPECT_EQ(log.line(99), "99999");
+    EXPECT_EQ(log.droppedLines(), 99900u);
+}
+
+TEST(OutputLogTest, ClearEmptiesTheLog) {
+    OutputLog log;
+    log.append("a\nb");
+    log.clear();
+    EXPECT_EQ(log.lineCount(), 0u);
+    log.append("c\n");
+    ASSERT_EQ(log.lineCount(), 1u);
+    EXPECT_EQ(log.line(0), "c");
+}
@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include "PerfCounters.h"
+#include <sstream>
+#include <string>
+
+TEST(PerfCountersTest, UnavailableCountersAreMissingNotZero) {
+    PerfCounters counters;
+    counters.start();
+    Interpreter interpreter;
+    std::any result = interpreter.evaluate("int s = 0; int i = 0; while (i < 100) { s = s + i; i = i + 1; } s;", false);
+    EXPECT_EQ(std::any_cast<int>(result), 4950);
+    PerfSample sample = counters.stop();
+
+    if (!counters.available()) {
+        EXPECT_FALSE(counters.unavailableReason().empty());
+        for (const auto &value : sample.values) {
+            EXPECT_FALSE(value.has_value());
+        }
+        EXPECT_FALSE(sample.ipc().has_value());
+        return;
+    }
+    // Whatever was counted saw real work.
+    if (sample[PerfCounters::Instructions]) {
+        EXPECT_GT(*sample[PerfCounters::Instructions], 10000u);
+    }
+    if (sample[PerfCounters::Cycles]) {
+        EXPECT_GT(*sample[PerfCounters::Cycles], 0u);
+    }
+}
+
+TEST(PerfCountersTest, StartResetsCounts) {
+    PerfCounters counters;
+    if (!counters.available() || !counters.stop()[PerfCounters::Instructions]) {
+        GTEST_SKIP() << "instruction counter unavailable: " << counters.unavailableReason();
+    }
+    Interpreter interpreter;
+    counters.start();
+    interpreter.evaluate("int s = 0; int i = 0; while (i < 1000) { s = s + i; i = i + 1; } s;", false);
+    uint64_t big = *counters.stop()[PerfCounters::Instructions];
+    counters.start();
+    uint64_t idle = *counters.stop()[PerfCounters::Instructions];
+    EXPECT_LT(idle, big);
+}
+
+TEST(PerfCountersTest, WritesEveryCounter) {
+    PerfSample sample;
+    sample.values[PerfCounters::Cycles] = 2000;
+    sample.values[PerfCounters::Instructions] = 3000;
+    std::ostringstream out;
+    writePerfSample(out, sample);
+    EXPECT_EQ(out.str(),
+              "[perf] cycles: 2000\n"
+              "[perf] instructions: 3000\n"
+              "[perf] branch-misses: n/a\n"
+              "[perf] cache-misses: n/a\n"
+              "[perf] IPC: 1.5\n");
+}
@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include "Profiler.h"
+#include <sstream>
+#include <string>
+
+namespace {
+
+const char *kProgram =
+    "int fib(int n) {\n"
+    "    if (n < 2) { return n; }\n"
+    "    return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "int main() {\n"
+    "    return fib(10);\n"
+    "}\n";
+
+} // namespace
+
+TEST(ProfilerTest, OffByDefault) {
+    Interpreter interpreter;
+    EXPECT_EQ(interpreter.profiler(), nullptr);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(kProgram, true)), 55);
+}
+
+TEST(ProfilerTest, CountsCallsAndLines) {
+    Interpreter interpreter;
+    interpreter.enableProfiling(true);
+    EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(kProgram, true)), 55);
+
+    const auto &functions = interpreter.profiler()->functions();
+    ASSERT_TRUE(functions.count("fib"));
+    ASSERT_TRUE(functions.count("main"));
+    EXPECT_EQ(functions.at("fib").calls, 177u);
+    EXPECT_EQ(functions.at("main").calls, 1u);
+    // main's inclusive time covers all of fib's.
+    EXPECT_GE(functions.at("main").inclusiveNs, functions.at("fib").inclusiveNs);
+    EXPECT_LE(functions.at("fib").exclusiveNs, functions.at("fib").inclusiveNs);
+
+    // The whole file is source 1.
+    const auto &lines = interpreter.profiler()->lines();
+    EXPECT_EQ(lines.at({1, 2}), 177u + 89u); // the if in fib, plus its return for n < 2
+    EXPECT_EQ(lines.at({1, 3}), 88u);        // the recursive return, n >= 2
+    EXPECT_EQ(lines.at({1, 6}), 1u);         // main's return
+    EXPECT_EQ(lines.size(), 3u);
+}
+
+TEST(ProfilerTest, FoldedStacksFollowTheCallTree) {
+    Interpreter interpreter;
+    interpreter.enableProfiling(true);
+    interpreter.evaluate(kProgram, true);
+
+    std::ostringstream folded;
+    interpreter.profiler()->writeFolded(folded);
+    std::string text = folded.str();
+    EXPECT_NE(text.find("main "), std::string::npos);
+    EXPECT_NE(text.find("main;fib "), std::string::npos);
+    EXPECT_NE(text.find("main;fib;fib;fib "), std::string::npos);
+
+    std::ostringstream summary;
+    interpreter.profiler()->writeSummary(summary);
+    EXPECT_NE(summary.str().find("fib"), std::string::npos);
+}
+
+TEST(ProfilerTest, ReplCodeIsAttributedToTopLevel) {
+    Interpreter interpreter;
+    interpreter.enableProfiling(true);
+    interpreter.evaluate("int twice(int x) { return x * 2; }", false);
+    interpreter.evaluate("twice(4);", false);
+
+    const auto &functions = interpreter.profiler()->functions();
+    EXPECT_EQ(functions.at("(toplevel)").calls, 2u);
+    EXPECT_EQ(functions.at("twice").calls, 1u);
+
+    std::ostringstream folded;
+    interpreter.profiler()->writeFolded(folded);
+    EXPECT_NE(folded.str().find("(toplevel);twice "), std::string::npos);
+
+    interpreter.enableProfiling(false);
+    EXPECT_EQ(interpreter.profiler(), nullptr);
+}
+
+TEST(ProfilerTest, LinesOfDifferentSourcesAreKeptApart) {
+    Interpreter interpreter;
+    interpreter.enableProfiling(true);
+    interpreter.evaluate("int twice(int x) {\n    return x * 2;\n}", false);
+    interpreter.evaluate("twice(1);", false);
+    interpreter.evaluate("3 + 4;", false);
+
+    // Each REPL input is its own source, numbered when first hit, and the
+    // function body belongs to the input that defined it: 1 is "twice(1);",
+    // 2 is twice's definition and 3 is "3 + 4;".
+    const auto &lines = interpreter.profiler()->lines();
+    EXPECT_EQ(lines.at({2, 2}), 1u);
+    EXPECT_EQ(lines.at({3, 1}), 1u);
+    EXPECT_EQ(lines.count({1, 1}), 1u);
+
+    std::ostringstream summary;
+    interpreter.profiler()->writeSummary(summary);
+    EXPECT_NE(summary.str().find("2:2"), std::string::npos);
+}
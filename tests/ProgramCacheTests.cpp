@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+#include "Interpreter.h"
+#include "ProgramCache.h"
+#include <any>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Each test gets its own empty cache directory.
+class ProgramCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("vci-cache-" + std::to_string(::getpid()) + "-" +
+               ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        fs::remove_all(dir);
+    }
+    void TearDown() override { fs::remove_all(dir); }
+
+    int run(const std::string &code) {
+        Interpreter interpreter;
+        interpreter.enableProgramCache(dir.string());
+        return std::any_cast<int>(interpreter.evaluate(code, true));
+    }
+
+    fs::path dir;
+};
+
+static const std::string kProgram =
+    "int base = 40; "
+    "char c = 'A'; "
+    "int twice(int x) { return x * 2; } "
+    "int derived = twice(3); "
+    "int main() { return base + derived - 6 + c - 'A' + 2; }";
+
+TEST_F(ProgramCacheTest, FirstRunStoresEntry) {
+    EXPECT_EQ(run(kProgram), 42);
+    ProgramCache cache(dir.string());
+    EXPECT_TRUE(fs::exists(cache.entryPath(kProgram)));
+    auto cached = cache.load(kProgram);
+    ASSERT_TRUE(cached.has_value());
+    ASSERT_EQ(cached->declarations.size(), 5u);
+    EXPECT_EQ(cached->declarations[0].kind, CachedDeclaration::Kind::GlobalValue);
+    EXPECT_EQ(cached->declarations[2].kind, CachedDeclaration::Kind::Function);
+    EXPECT_EQ(cached->declarations[2].function.parameterNames.size(), 1u);
+    // A global initialised by a call is re-evaluated from its source.
+    EXPECT_EQ(cached->declarations[3].kind, CachedDeclaration::Kind::GlobalSource);
+}
+
+TEST_F(ProgramCacheTest, CachedRunMatchesUncached) {
+    EXPECT_EQ(run(kProgram), 42);
+    EXPECT_EQ(run(kProgram), 42);   // served from the cache
+    EXPECT_EQ(run(kProgram), 42);
+}
+
+TEST_F(ProgramCacheTest, HitParsesOnlyWhatRuns) {
+    if (!allocations::enabled()) {
+        GTEST_SKIP() << "built without VCI_TRACK_ALLOCATIONS";
+    }
+    // Many functions that never run, so parsing them would show.
+    std::string program = kProgram;
+    for (int i = 0; i < 100; ++i) {
+        program += " int unused" + std::to_string(i) + "(int x) { return x * " + std::to_string(i) + " + 1; }";
+    }
+    Interpreter first;
+    first.enableProgramCache(dir.string());
+    ASSERT_EQ(std::any_cast<int>(first.evaluate(program, true)), 42);
+    EvaluationAllocations miss = first.lastEvaluationAllocations();
+
+    Interpreter second;
+    second.enableProgramCache(dir.string());
+    ASSERT_EQ(std::any_cast<int>(second.evaluate(program, true)), 42);
+    EvaluationAllocations hit = second.lastEvaluationAllocations();
+
+    // No parse unit is made for the source...
+    EXPECT_EQ(hit.lex.allocations, 0u);
+    // ...and of the functions only main and twice are parsed, so the whole
+    // hit allocates a fraction of what parsing the program did.
+    EXPECT_LT(hit.total().allocations * 2, miss.parse.allocations);
+}
+
+TEST_F(ProgramCacheTest, DifferentSourceMisses) {
+    EXPECT_EQ(run("int main() { return 1; }"), 1);
+    EXPECT_EQ(run("int main() { return 2; }"), 2);
+    ProgramCache cache(dir.string());
+    EXPECT_NE(cache.entryPath("int main() { return 1; }"), cache.entryPath("int main() { return 2; }"));
+}
+
+TEST_F(ProgramCacheTest, CorruptEntryIsRebuilt) {
+    ASSERT_EQ(run(kProgram), 42);
+    ProgramCache cache(dir.string());
+    std::string path = cache.entryPath(kProgram);
+
+    // Flip a byte in the middle of the payload.
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(static_cast<std::streamoff>(fs::file_size(path) / 2));
+        f.put('\x7f');
+    }
+    EXPECT_FALSE(cache.load(kProgram).has_value());
+    EXPECT_EQ(run(kProgram), 42);
+    EXPECT_TRUE(cache.load(kProgram).has_value());
+}
+
+TEST_F(ProgramCacheTest, TruncatedEntryIsRebuilt) {
+    ASSERT_EQ(run(kProgram), 42);
+    ProgramCache cache(dir.string());
+    std::string path = cache.entryPath(kProgram);
+    fs::resize_file(path, 10);
+    EXPECT_FALSE(cache.load(kProgram).has_value());
+    EXPECT_EQ(run(kProgram), 42);
+    EXPECT_TRUE(cache.load(kProgram).has_value());
+}
+
+TEST_F(ProgramCacheTest, RecursiveFunctionFromCache) {
+    std::string code =
+        "int fact(int n) { if (n <= 1) return 1; return n * fact(n - 1); } "
+        "int main() { return fact(5); }";
+    EXPECT_EQ(run(code), 120);
+    EXPECT_EQ(run(code), 120);
+}
+
+// Functions from a cache hit are parsed on first call. Forks of one snapshot
+// share them, so the first calls can come from several threads at once.
+TEST_F(ProgramCacheTest, CachedFunctionsParseOnceAcrossThreads) {
+    const std::string program = "int triple(int x) { return x * 3; } int main() { return 0; }";
+    ASSERT_EQ(run(program), 0);
+    Interpreter loaded;
+    loaded.enableProgramCache(dir.string());
+    ASSERT_EQ(std::any_cast<int>(loaded.evaluate(program, true)), 0); // a hit; triple is not parsed yet
+    auto prelude = loaded.snapshot();
+
+    std::vector<int> results(8);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            Interpreter session(prelude);
+            results[t] = std::any_cast<int>(session.evaluate("triple(" + std::to_string(t) + ");", false));
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < 8; ++t) {
+        EXPECT_EQ(results[t], 3 * t);
+    }
+}
+
+TEST_F(ProgramCacheTest, ConcurrentStoresOfOneEntry) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; ++i) {
+                Interpreter interpreter;
+                interpreter.enableProgramCache(dir.string());
+                EXPECT_EQ(std::any_cast<int>(interpreter.evaluate(kProgram, true)), 42);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(ProgramCache(dir.string()).load(kProgram).has_value());
+    // Every temporary was renamed into place or removed.
+    for (const auto &entry : fs::directory_iterator(dir)) {
+        EXPECT_EQ(entry.path().string().find(".tmp"), std::string::npos) << entry.path();
+    }
+}
@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "REPL.h"
 #include <sstream>
+#include <stdexcept>
+#include <streambuf>
 #include <string>
 
 TEST(REPLTest, RunValidInput) {
@@ -162,3 +164,56 @@ TEST(REPLTest, MultipleSequentialCommands) {
     EXPECT_LT(pos4, pos9);
     EXPECT_LT(pos9, pos6);
 }
+
+// Pipe mode prints one line per statement, keeps going after errors and
+// handles a final line without a newline.
+TEST(REPLTest, PipeModeOneResultPerLine) {
+    std::istringstream input("2 + 2;\n\n3 + ;\n 1.5 * 2; \n'a';\n7 - 1;");
+    std::ostringstream output;
+    REPL repl;
+    repl.runPipe(input, output);
+
+    std::string outStr = output.str();
+    ASSERT_EQ(outStr.rfind("4\nError: ", 0), 0u) << outStr;
+    EXPECT_NE(outStr.find("\n3.000000\na\n6\n"), std::string::npos) << outStr;
+}
+
+TEST(REPLTest, PipeModeStopsAtExit) {
+    std::istringstream input("1 + 1;\nexit\n5 + 5;\n");
+    std::ostringstream output;
+    REPL repl;
+    repl.runPipe(input, output);
+    EXPECT_EQ(output.str(), "2\n");
+}
+
+// More input than one read block, with state carried across lines.
+TEST(REPLTest, PipeModeLongScript) {
+    std::string script = "int total = 0;\n";
+    for (int i = 1; i <= 20000; ++i) {
+        script += "total = total + 1;\n";
+    }
+    script += "total;\n";
+    std::istringstream input(script);
+    std::ostringstream output;
+    REPL repl;
+    repl.runPipe(input, output);
+
+    std::string outStr = output.str();
+    EXPECT_EQ(outStr.substr(outStr.size() - 6), "20000\n");
+}
+
+// A pipe whose input fails leaves with the exception, and takes its output
+// target along: what the session prints afterwards is buffered as usual.
+TEST(REPLTest, PipeModeFailingInputResetsOutputTarget) {
+    struct FailingInput : std::streambuf {
+        int_type underflow() override { throw std::runtime_error("read failed"); }
+    } failing;
+    std::istream input(&failing);
+    input.exceptions(std::ios::badbit);
+    REPL repl;
+    {
+        std::ostringstream output;
+        EXPECT_THROW(repl.runPipe(input, output), std::runtime_error);
+    }
+    EXPECT_EQ(repl.evaluateCommand("puts(\"after\");").rfind("after\n", 0), 0u);
+}
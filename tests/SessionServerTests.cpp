@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+#include "SessionProtocol.h"
+#include "SessionServer.h"
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string socketPath(const char *name) {
+    return "/tmp/vci-test-" + std::to_string(::getpid()) + "-" + name + ".sock";
+}
+
+// A server running on its own thread for the lifetime of the fixture.
+struct RunningServer {
+    explicit RunningServer(SessionServer::Options options)
+        : server(std::move(options)), thread([this] { server.run(); }) {}
+    ~RunningServer() {
+        server.stop();
+        thread.join();
+    }
+    SessionServer server;
+    std::thread thread;
+};
+
+} // namespace
+
+TEST(SessionServerTest, SessionsKeepTheirOwnState) {
+    SessionServer::Options options;
+    options.socketPath = socketPath("state");
+    options.workers = 2;
+    RunningServer running(options);
+
+    session::Client a(options.socketPath);
+    session::Client b(options.socketPath);
+    EXPECT_EQ(a.request("int x = 5;").status, session::Status::Ok);
+    EXPECT_EQ(b.request("int x = 7;").status, session::Status::Ok);
+    EXPECT_EQ(a.request("x * 2;").text, "10");
+    EXPECT_EQ(b.request("x * 2;").text, "14");
+}
+
+TEST(SessionServerTest, ErrorsAreReportedAndSessionContinues) {
+    SessionServer::Options options;
+    options.socketPath = socketPath("errors");
+    RunningServer running(options);
+
+    session::Client client(options.socketPath);
+    session::Response bad = client.request("1 + ;");
+    EXPECT_EQ(bad.status, session::Status::Error);
+    EXPECT_NE(bad.text.find("Syntax error"), std::string::npos);
+    EXPECT_EQ(client.request("2 + 3;").text, "5");
+}
+
+TEST(SessionServerTest, RunawayRequestHitsTheBudget) {
+    SessionServer::Options options;
+    options.socketPath = socketPath("budget");
+    options.budget.maxSteps = 1000;
+    RunningServer running(options);
+
+    session::Client client(options.socketPath);
+    EXPECT_EQ(client.request("while (1) { }").status, session::Status::Error);
+    EXPECT_EQ(client.request("6 * 7;").text, "42");
+}
+
+TEST(SessionServerTest, SessionsStartFromPrelude) {
+    Interpreter prelude;
+    prelude.evaluate("int square(int v) { return v * v; }", false);
+    SessionServer::Options options;
+    options.socketPath = socketPath("prelude");
+    options.prelude = prelude.snapshot();
+    RunningServer running(options);
+
+    session::Client client(options.socketPath);
+    EXPECT_EQ(client.request("square(9);").text, "81");
+}
+
+// Pipelined requests on many connections come back complete and in order.
+TEST(SessionServerTest, ManyConcurrentSessions) {
+    SessionServer::Options options;
+    options.socketPath = socketPath("many");
+    options.workers = 4;
+    RunningServer running(options);
+
+    std::vector<std::thread> clients;
+    std::vector<int> finals(32, 0);
+    for (int c = 0; c < 32; ++c) {
+        clients.emplace_back([&, c] {
+            session::Client client(options.socketPath);
+            client.request("int n = 0;");
+            for (int i = 0; i < 50; ++i) {
+                finals[c] = std::stoi(client.request("n = n + " + std::to_string(c + 1) + ";").text);
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    for (int c = 0; c < 32; ++c) {
+        EXPECT_EQ(finals[c], 50 * (c + 1));
+    }
+}
+
+TEST(SessionServerTest, LiveSocketIsNotTakenOver) {
+    SessionServer::Options options;
+    options.socketPath = socketPath("taken");
+    RunningServer running(options);
+
+    EXPECT_THROW(SessionServer second(options), std::runtime_error);
+    session::Client client(options.socketPath);
+    EXPECT_EQ(client.request("1 + 1;").text, "2");
+}
+
+// A client that shuts down its sending side still gets every response.
+TEST(SessionServerTest, HalfClosedSessionsAreAnswered) {
+    SessionServer::Options options;
+    options.socketPath = socketPath("halfclose");
+    RunningServer running(options);
+
+    int fd = session::connectTo(options.socketPath);
+    std::string frames;
+    session::appendFrame(frames, "int x = 20;");
+    session::appendFrame(frames, "x + 1;");
+    session::appendFrame(frames, "x + 2;");
+    ASSERT_EQ(::send(fd, frames.data(), frames.size(), MSG_NOSIGNAL), static_cast<ssize_t>(frames.size()));
+    ::shutdown(fd, SHUT_WR);
+
+    std::string received;
+    std::vector<std::string> texts;
+    char chunk[4096];
+    for (;;) {
+        std::string_view payload;
+        size_t frameSize = 0;
+        if (session::nextFrame(received, payload, frameSize)) {
+            texts.push_back(session::parseResponse(payload).text);
+            received.erase(0, frameSize);
+            continue;
+        }
+        ssize_t n = ::recv(fd, chunk, sizeof chunk, 0);
+        if (n <= 0) {
+            break; // the server closes once everything is answered
+        }
+        received.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    ASSERT_EQ(texts.size(), 3u);
+    EXPECT_EQ(texts[1], "21");
+    EXPECT_EQ(texts[2], "22");
+}
@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+#include "Trace.h"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Decodes a fresh snapshot and returns the lines mentioning `event`.
+std::vector<std::string> decodedLines(const char *event) {
+    std::stringstream snapshot;
+    trace::writeSnapshot(snapshot);
+    std::stringstream text;
+    EXPECT_TRUE(trace::decode(snapshot, text));
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(text, line);) {
+        if (line.find(std::string(" ") + event + " ") != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+int sideEffects = 0;
+int64_t countedArgument() {
+    ++sideEffects;
+    return 0;
+}
+
+} // namespace
+
+TEST(TraceTest, RecordsAreDecodedWithTheirArguments) {
+    std::thread([] { trace::record(VCI_TRACE_INFO, TraceEvent::ReplResult, 1234, -5); }).join();
+    auto lines = decodedLines("ReplResult");
+    bool found = false;
+    for (const auto &line : lines) {
+        found = found || line.find("a=1234 b=-5") != std::string::npos;
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST(TraceTest, RingKeepsTheMostRecentEvents) {
+    std::thread([] {
+        for (int64_t i = 0; i < trace::kRingCapacity + 100; ++i) {
+            trace::record(VCI_TRACE_DEBUG, TraceEvent::ForIteration, 777, i);
+        }
+    }).join();
+    int count = 0;
+    for (const auto &line : decodedLines("ForIteration")) {
+        if (line.find("a=777 ") != std::string::npos) {
+            ++count;
+            // The first 100 iterations were overwritten.
+            EXPECT_GE(std::stoll(line.substr(line.rfind("b=") + 2)), 100);
+        }
+    }
+    EXPECT_EQ(count, static_cast<int>(trace::kRingCapacity));
+}
+
+TEST(TraceTest, DisabledLevelsDoNotEvaluateArguments) {
+    sideEffects = 0;
+    TRACE(VCI_TRACE_DEBUG + 1, TraceEvent::CallEnter, countedArgument());
+    EXPECT_EQ(sideEffects, 0);
+}
+
+TEST(TraceTest, DecodeRejectsOtherData) {
+    std::stringstream in("not a trace");
+    std::stringstream out;
+    EXPECT_FALSE(trace::decode(in, out));
+}